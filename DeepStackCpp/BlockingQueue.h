@@ -0,0 +1,71 @@
+#pragma once
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <utility>
+
+using namespace std;
+
+//-- - A bounded queue that hands items from producer threads to consumer threads.
+//--
+//-- A full queue blocks the producers, so a fast stage does not run ahead of a slow one,
+//-- and an empty queue blocks the consumers until an item arrives or the queue is closed.
+template <typename T>
+class BlockingQueue
+{
+public:
+	//-- @param capacity the number of items that the queue holds before @{push} blocks
+	explicit BlockingQueue(size_t capacity) : _capacity(capacity)
+	{
+	}
+
+	//-- - Adds an item, waiting while the queue is full.
+	void push(T&& item)
+	{
+		unique_lock<mutex> lock(_mutex);
+		_not_full.wait(lock, [this]() { return _items.size() < _capacity; });
+		_items.push_back(move(item));
+		_not_empty.notify_one();
+	}
+
+	//-- - Takes the oldest item, waiting while the queue is empty and open.
+	//-- @param[out] item the item
+	//-- @return `false` once the queue is closed and empty
+	bool pop(T& item)
+	{
+		unique_lock<mutex> lock(_mutex);
+		_not_empty.wait(lock, [this]() { return !_items.empty() || _closed; });
+
+		if (_items.empty())
+		{
+			return false;
+		}
+
+		item = move(_items.front());
+		_items.pop_front();
+		_not_full.notify_one();
+		return true;
+	}
+
+	//-- - Tells the consumers that no more items will be pushed.
+	void close()
+	{
+		lock_guard<mutex> lock(_mutex);
+		_closed = true;
+		_not_empty.notify_all();
+	}
+
+private:
+
+	const size_t _capacity;
+
+	deque<T> _items;
+
+	bool _closed = false;
+
+	mutex _mutex;
+
+	condition_variable _not_full;
+
+	condition_variable _not_empty;
+};
@@ -0,0 +1,145 @@
+#pragma once
+#include "CustomSettings.h"
+#include "game_settings.h"
+#include "assert.h"
+
+#include <array>
+#include <cstdint>
+
+using namespace std;
+
+static_assert(card_count <= 64, "the cards of a CardSet must fit in its mask");
+
+//-- - A set of cards that holds a board, or a board and a private card.
+//--
+//--The cards are kept as a bit mask for the set operations and in the order they
+//-- were added for iteration, so the set is small, copied by value and never allocates.
+class CardSet
+{
+public:
+	// The largest set, a full board and a private card
+	static const int max_size = board_card_count + 1;
+
+	CardSet()
+	{
+	}
+
+	//-- - Creates the set of the cards of a vector.
+	//-- @param cards a possibly empty vector of distinct cards, at most @{max_size} of them
+	explicit CardSet(const ArrayX& cards)
+	{
+		for (int i = 0; i < cards.size(); i++)
+		{
+			add((int)cards(i));
+		}
+
+		assert(_size == cards.size() && "repeated card");
+	}
+
+	//-- - Adds a card unless the set already holds it.
+	//-- @param card the numeric card
+	//-- @return `false` if the card was already in the set
+	bool add(int card)
+	{
+		assert(card >= 0 && card < card_count && "illegal card");
+
+		if (contains(card))
+		{
+			return false;
+		}
+
+		assert(_size < max_size && "too many cards");
+		_mask |= bit(card);
+		_cards[_size++] = (uint8_t)card;
+		return true;
+	}
+
+	//-- - Gives whether the set holds a card.
+	bool contains(int card) const
+	{
+		return (_mask & bit(card)) != 0;
+	}
+
+	//-- - Gives whether the sets share a card.
+	bool overlaps(const CardSet& other) const
+	{
+		return (_mask & other._mask) != 0;
+	}
+
+	//-- - Gives the number of cards.
+	int size() const
+	{
+		return _size;
+	}
+
+	bool empty() const
+	{
+		return _size == 0;
+	}
+
+	//-- - Gives a card in the order the cards were added.
+	int operator[](int i) const
+	{
+		assert(i >= 0 && i < _size);
+		return _cards[i];
+	}
+
+	//-- - Gives the mask with the bit `card` set for every card, which identifies the set whatever the order of its cards.
+	uint64_t mask() const
+	{
+		return _mask;
+	}
+
+	//-- - Gives the index of a non - empty board among the boards of its size in the order of
+	//-- @{card_tools.get_second_round_boards}, the card itself for a single card.
+	int board_index() const
+	{
+		assert((_size == 1 || _size == 2) && "unsupported board size");
+
+		if (_size == 1)
+		{
+			return _cards[0];
+		}
+
+		//--boards of two cards are ordered by their lower card, then by their higher card
+		const int low = _cards[0] < _cards[1] ? _cards[0] : _cards[1];
+		const int high = _cards[0] < _cards[1] ? _cards[1] : _cards[0];
+		return low * (2 * card_count - low - 1) / 2 + high - low - 1;
+	}
+
+	//-- - Gives the cards as a vector in the order they were added.
+	ArrayX to_array() const
+	{
+		ArrayX out(_size);
+		for (int i = 0; i < _size; i++)
+		{
+			out(i) = (float)_cards[i];
+		}
+
+		return out;
+	}
+
+	bool operator==(const CardSet& other) const
+	{
+		return _mask == other._mask;
+	}
+
+	bool operator!=(const CardSet& other) const
+	{
+		return _mask != other._mask;
+	}
+
+	//-- - Gives the mask bit of a card.
+	static uint64_t bit(int card)
+	{
+		return (uint64_t)1 << card;
+	}
+
+private:
+
+	uint64_t _mask = 0;
+
+	std::array<uint8_t, max_size> _cards;
+
+	int _size = 0;
+};
@@ -24,6 +24,16 @@ enum node_types { uninitialized = -100, bet = -4, terminal_fold = -3, terminal_c
 
 
 
+//  Regret minimization variants of @{TreeCFR}
+// @field cfr_vanilla(simultaneous updates, uniform average after the skipped iterations) `0`
+// @field cfr_plus(regret-matching+, alternating updates, linearly weighted average) `1`
+enum cfr_modes { cfr_vanilla = 0, cfr_plus = 1 };
+
+//  Units of an exploitability target
+// @field exploitability_chips(chips per hand) `0`
+// @field exploitability_mbb(thousandths of the ante per hand) `1`
+enum exploitability_units { exploitability_chips = 0, exploitability_mbb = 1 };
+
 //  IDs for fold and check/call actions
 enum actions { fold = -2, ccall = -1 };
 
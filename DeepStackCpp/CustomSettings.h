@@ -1,6 +1,7 @@
 #pragma once
 #include <Eigen/Dense>
 #include "game_settings.h"
+#include <array>
 #include <unsupported/Eigen/CXX11/Tensor>
 
 typedef float mainDataType;
@@ -31,6 +32,12 @@ typedef float mainDataType;
 //typedef Eigen::TensorFixedSize<float, Sizes<1>> Tf1;
 #define CardArray Eigen::Array<float, card_count, MyLayoutType>
 
+// A permutation of the cards, `permutation[card]` is the image of the card
+#define CardPermutation std::array<int, card_count>
+
+// The column of every card in a list of hands, `columns[card]` is -1 for the cards that are not in the list
+#define HandColumns std::array<int, card_count>
+
 #define TbN Eigen::TensorBase<float, N>
 #define Tb5 Eigen::TensorBase<float, 5>
 #define Tb4 Eigen::TensorBase<float, 4>
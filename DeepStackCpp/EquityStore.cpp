@@ -0,0 +1,184 @@
+#include "EquityStore.h"
+#include "terminal_equity.h"
+#include "card_tools.h"
+
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+static const char store_magic[8] = { 'D', 'S', 'E', 'Q', 'U', 'I', 'T', 'Y' };
+
+// The data blocks start on cache lines
+static const uint64_t block_alignment = 64;
+
+EquityStore::EquityStore()
+{
+}
+
+EquityStore::~EquityStore()
+{
+	close();
+}
+
+int EquityStore::_boards_count()
+{
+	return 1 + (int)card_tools().get_boards_count();
+}
+
+bool EquityStore::write(const string& path, bool dense)
+{
+	ofstream out(path, ios::out | ios::binary | ios::trunc);
+	if (!out)
+	{
+		return false;
+	}
+
+	//--the empty board, then every board in the order of its index
+	card_tools cardTools;
+	ArrayXX boards = cardTools.get_second_round_boards();
+	const int boards_count = _boards_count();
+
+	Header header;
+	memcpy(header.magic, store_magic, sizeof(store_magic));
+	header.version = version;
+	header.suit_count = suit_count;
+	header.rank_count = rank_count;
+	header.card_count = card_count;
+	header.board_card_count = board_card_count;
+	header.boards_count = boards_count;
+
+	vector<Entry> entries(boards_count);
+	uint64_t offset = sizeof(Header) + boards_count * sizeof(Entry);
+
+	//--the entries are written once the offsets of all the blocks are known
+	out.write((const char*)&header, sizeof(Header));
+	out.write((const char*)entries.data(), entries.size() * sizeof(Entry));
+
+	auto write_block = [&out, &offset](const void* block, uint64_t size)
+	{
+		const uint64_t start = (offset + block_alignment - 1) / block_alignment * block_alignment;
+		const vector<char> padding((size_t)(start - offset), 0);
+		out.write(padding.data(), padding.size());
+		out.write((const char*)block, size);
+		offset = start + size;
+		return start;
+	};
+
+	for (int slot = 0; slot < boards_count; slot++)
+	{
+		ArrayX board = slot == 0 ? ArrayX() : ArrayX(boards.row(slot - 1));
+		const terminal_equity equity(board);
+		Entry& entry = entries[slot];
+
+		entry.board_mask = CardSet(board).mask();
+		entry.hands_count = equity._hands_count;
+		entry.order_count = (uint32_t)equity._strength_order.size();
+		entry.groups_count = (uint32_t)equity._strength_groups.size();
+		entry.dense = dense || equity._strength_order.empty() ? 1 : 0;
+		entry.call_matrix_offset = 0;
+		entry.compact_call_matrix_offset = 0;
+
+		if (entry.dense)
+		{
+			entry.call_matrix_offset = write_block(equity._equity_matrix.data(), equity._equity_matrix.size() * sizeof(float));
+			entry.compact_call_matrix_offset = write_block(equity._compact_equity_matrix.data(), equity._compact_equity_matrix.size() * sizeof(float));
+		}
+
+		vector<int32_t> orders(equity._strength_order.begin(), equity._strength_order.end());
+		orders.insert(orders.end(), equity._compact_strength_order.begin(), equity._compact_strength_order.end());
+		orders.insert(orders.end(), equity._strength_groups.begin(), equity._strength_groups.end());
+		entry.order_offset = write_block(orders.data(), orders.size() * sizeof(int32_t));
+	}
+
+	out.seekp(sizeof(Header));
+	out.write((const char*)entries.data(), entries.size() * sizeof(Entry));
+	return (bool)out;
+}
+
+bool EquityStore::open(const string& path)
+{
+	close();
+
+	if (!_file.open(path))
+	{
+		return false;
+	}
+
+	const char* data = _file.data();
+	const uint64_t size = _file.size();
+
+	//--a file of another layout or of another game is not used
+	const int boards_count = _boards_count();
+	const Header* header = (const Header*)data;
+	const bool valid = size >= sizeof(Header) + boards_count * sizeof(Entry)
+		&& memcmp(header->magic, store_magic, sizeof(store_magic)) == 0
+		&& header->version == version
+		&& header->suit_count == suit_count
+		&& header->rank_count == rank_count
+		&& header->card_count == card_count
+		&& header->board_card_count == board_card_count
+		&& header->boards_count == (uint32_t)boards_count;
+
+	if (!valid)
+	{
+		close();
+		return false;
+	}
+
+	const Entry* entries = (const Entry*)(data + sizeof(Header));
+	for (int slot = 0; slot < boards_count; slot++)
+	{
+		const Entry& entry = entries[slot];
+		const uint64_t orders_size = (2 * (uint64_t)entry.order_count + entry.groups_count) * sizeof(int32_t);
+		const uint64_t call_matrix_end = entry.dense ? entry.call_matrix_offset + (uint64_t)card_count * card_count * sizeof(float) : 0;
+		const uint64_t compact_call_matrix_end = entry.dense ? entry.compact_call_matrix_offset + (uint64_t)entry.hands_count * entry.hands_count * sizeof(float) : 0;
+
+		if (entry.order_offset + orders_size > size || call_matrix_end > size || compact_call_matrix_end > size)
+		{
+			close();
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void EquityStore::close()
+{
+	_file.close();
+}
+
+bool EquityStore::is_open() const
+{
+	return _file.is_open();
+}
+
+bool EquityStore::find(const CardSet& board, BoardData& data) const
+{
+	if (!_file.is_open())
+	{
+		return false;
+	}
+
+	const char* file = _file.data();
+	const int slot = board.empty() ? 0 : 1 + board.board_index();
+	const Entry& entry = ((const Entry*)(file + sizeof(Header)))[slot];
+	assert(entry.board_mask == board.mask() && "the entries are in the order of the boards");
+
+	data = BoardData();
+	data.hands_count = entry.hands_count;
+
+	if (entry.dense)
+	{
+		data.call_matrix = (const float*)(file + entry.call_matrix_offset);
+		data.compact_call_matrix = (const float*)(file + entry.compact_call_matrix_offset);
+	}
+
+	const int32_t* orders = (const int32_t*)(file + entry.order_offset);
+	data.order_count = entry.order_count;
+	data.strength_order = orders;
+	data.compact_strength_order = orders + entry.order_count;
+	data.groups_count = entry.groups_count;
+	data.strength_groups = orders + 2 * entry.order_count;
+	return true;
+}
@@ -0,0 +1,108 @@
+#pragma once
+#include "CustomSettings.h"
+#include "game_settings.h"
+#include "CardSet.h"
+#include "MappedFile.h"
+
+#include <cstdint>
+#include <string>
+
+using namespace std;
+
+//-- - Read-only file of the precomputed @{terminal_equity} data of every board.
+//--
+//-- The file holds a header, one entry per board in the order of @{card_tools._board_slot}, the empty
+//-- board first, and the data blocks of the boards. @{write} builds it offline, @{open} maps it, so the
+//-- processes that load the same file share its pages and start without computing any matrix.
+//-- A last round board is stored either dense, with its call matrices, or in the sorted form, with
+//-- only the strength order that @{terminal_equity.sorted_call_value} needs. The first round board
+//-- has no strength order and is always dense.
+class EquityStore
+{
+public:
+	// The version of the layout, a file of another version is not opened
+	static const uint32_t version = 2;
+
+	// The stored data of a board. The pointers are into the mapped file.
+	struct BoardData
+	{
+		// [card_count x card_count] call matrix, null in the sorted form
+		const float* call_matrix = nullptr;
+
+		// [hands_count x hands_count] call matrix of the compact hand space, null in the sorted form
+		const float* compact_call_matrix = nullptr;
+
+		// The number of hands that the board does not block
+		int hands_count = 0;
+
+		// The strength order of the hands and of their compact columns, order_count each, none for the first round
+		const int32_t* strength_order = nullptr;
+		const int32_t* compact_strength_order = nullptr;
+		int order_count = 0;
+
+		// The first hand of every group of equally strong hands, groups_count of them
+		const int32_t* strength_groups = nullptr;
+		int groups_count = 0;
+	};
+
+	EquityStore();
+	~EquityStore();
+
+	EquityStore(const EquityStore&) = delete;
+	EquityStore& operator=(const EquityStore&) = delete;
+
+	//-- - Computes the equity data of every board and writes the file.
+	//-- @param path the file to write, replaced if it exists
+	//-- @param[opt] dense whether the last round boards keep their call matrices(default true),
+	//-- the sorted form is enough when @{arguments.sorted_showdown} is set
+	//-- @return `false` if the file could not be written
+	static bool write(const string& path, bool dense = true);
+
+	//-- - Maps a file written by @{write}.
+	//-- @param path the file to map
+	//-- @return `false` if the file is missing, or was written by another version or for another game
+	bool open(const string& path);
+
+	//-- - Unmaps the file. The data of the boards must not be used afterwards.
+	void close();
+
+	bool is_open() const;
+
+	//-- - Gives the stored data of a board.
+	//-- @param board a possibly empty set of board cards
+	//-- @param[out] data the data of the board
+	//-- @return `false` if no file is open
+	bool find(const CardSet& board, BoardData& data) const;
+
+private:
+
+	// The first bytes of the file
+	struct Header
+	{
+		char magic[8];
+		uint32_t version;
+		uint32_t suit_count;
+		uint32_t rank_count;
+		uint32_t card_count;
+		uint32_t board_card_count;
+		uint32_t boards_count;
+	};
+
+	// The location of the data of a board, offsets are from the start of the file
+	struct Entry
+	{
+		uint64_t board_mask;
+		uint64_t call_matrix_offset;
+		uint64_t compact_call_matrix_offset;
+		uint64_t order_offset;
+		uint32_t hands_count;
+		uint32_t order_count;
+		uint32_t groups_count;
+		uint32_t dense;
+	};
+
+	// The number of boards in a file, the empty board and every second round board
+	static int _boards_count();
+
+	MappedFile _file;
+};
@@ -0,0 +1,376 @@
+#include "FlatTree.h"
+
+
+FlatTree::FlatTree(Node& root, int batch_size, bool compact) : batch_size(batch_size), columns_count(batch_size * card_count), compact(compact)
+{
+	assert(batch_size > 0);
+	assert((!compact || batch_size == 1) && "the hand spaces are per board, not per situation");
+
+	//--1.0 number the nodes breadth first, so the children of each node are contiguous
+	nodes.push_back(&root);
+	parent.push_back(-1);
+	child_id.push_back(0);
+	depth.push_back(0);
+
+	for (size_t i = 0; i < nodes.size(); i++)
+	{
+		Node* node = nodes[i];
+		first_child.push_back((int)nodes.size());
+		children_count.push_back((int)node->children.size());
+
+		for (size_t childId = 0; childId < node->children.size(); childId++)
+		{
+			nodes.push_back(node->children[childId]);
+			parent.push_back((int)i);
+			child_id.push_back((int)childId);
+			depth.push_back(depth[i] + 1);
+		}
+	}
+
+	nodes_count = (int)nodes.size();
+
+	//--2.0 copy the structure
+	type.resize(nodes_count);
+	terminal.resize(nodes_count);
+	current_player.resize(nodes_count);
+	street.resize(nodes_count);
+	pot.resize(nodes_count);
+	fold_mask.resize(nodes_count);
+	board_index.resize(nodes_count);
+	suit_permutations.resize(nodes_count);
+	width.resize(nodes_count);
+	_hands.resize(nodes_count);
+	_hand_columns.resize(nodes_count);
+	bets = ArrayXX::Zero(nodes_count, players_count);
+
+	for (int i = 0; i < nodes_count; i++)
+	{
+		Node* node = nodes[i];
+		type[i] = node->type;
+		terminal[i] = node->terminal;
+		current_player[i] = node->current_player;
+		street[i] = node->street;
+		pot[i] = node->pot;
+		fold_mask[i] = node->foldMask;
+		board_index[i] = node->board.size() == 0 ? -1 : _card_tools.get_board_index(node->board);
+		suit_permutations[i] = node->suit_permutations;
+		bets(i, P1) = node->bets(P1);
+		bets(i, P2) = node->bets(P2);
+
+		//--the hand space of a node that is not compact is every hand of the empty board
+		const CardSet hand_space_board = compact ? CardSet(node->board) : CardSet();
+		_hands[i] = &_card_tools.get_possible_hands(hand_space_board);
+		_hand_columns[i] = &_card_tools.get_hand_columns(hand_space_board);
+		width[i] = compact ? (int)_hands[i]->size() : columns_count;
+
+		if (i == 0 || depth[i] != depth[i - 1])
+		{
+			level_start.push_back(i);
+		}
+	}
+
+	level_start.push_back(nodes_count);
+
+	//--3.0 allocate the payloads and import the saved strategies and regrets
+	_arena = ArrayX::Zero((size_t)PlanesCount * nodes_count * columns_count);
+
+	for (int i = 0; i < nodes_count; i++)
+	{
+		Node* node = nodes[i];
+		if (children_count[i] > 0 && node->strategy.size() > 0)
+		{
+			_import_actions(strategy(), i, node->strategy);
+		}
+
+		if (children_count[i] > 0 && node->regrets.size() > 0)
+		{
+			_import_actions(regrets(), i, node->regrets);
+		}
+	}
+}
+
+AmAxx FlatTree::_plane(int plane)
+{
+	return AmAxx(_arena.data() + (size_t)plane * nodes_count * columns_count, nodes_count, columns_count);
+}
+
+AmAxx FlatTree::ranges(int player)
+{
+	assert(player == P1 || player == P2);
+	return _plane(RangesP1 + player);
+}
+
+AmAxx FlatTree::cf_values(int player)
+{
+	assert(player == P1 || player == P2);
+	return _plane(CfValuesP1 + player);
+}
+
+AmAxx FlatTree::cf_values_br(int player)
+{
+	assert(player == P1 || player == P2);
+	return _plane(CfValuesBrP1 + player);
+}
+
+AmAxx FlatTree::strategy()
+{
+	return _plane(Strategy);
+}
+
+AmAxx FlatTree::current_strategy()
+{
+	return _plane(CurrentStrategy);
+}
+
+AmAxx FlatTree::regrets()
+{
+	return _plane(Regrets);
+}
+
+AmAxx FlatTree::reach_sum()
+{
+	return _plane(ReachSum);
+}
+
+AmAxx FlatTree::pruned_reach()
+{
+	return _plane(PrunedReach);
+}
+
+void FlatTree::_import_actions(AmAxx plane, int node, const ArrayXX& values)
+{
+	assert(values.rows() == children_count[node] && (values.cols() == card_count || values.cols() == columns_count));
+	auto rows = plane.middleRows(first_child[node], children_count[node]);
+
+	if (!compact)
+	{
+		//--the payloads of a single situation are shared by the whole batch
+		rows = values.replicate(1, columns_count / values.cols());
+		return;
+	}
+
+	const vector<int>& node_hands = hands(node);
+
+	for (size_t column = 0; column < node_hands.size(); column++)
+	{
+		rows.col(column) = values.col(node_hands[column]);
+	}
+}
+
+void FlatTree::_export_actions(AmAxx plane, int node, ArrayXX& values, float blocked_value)
+{
+	auto rows = plane.middleRows(first_child[node], children_count[node]);
+
+	if (!compact)
+	{
+		values = rows;
+		return;
+	}
+
+	if (values.rows() != children_count[node] || values.cols() != columns_count)
+	{
+		values = ArrayXX::Constant(children_count[node], columns_count, blocked_value);
+	}
+
+	const vector<int>& node_hands = hands(node);
+
+	for (size_t column = 0; column < node_hands.size(); column++)
+	{
+		values.col(node_hands[column]) = rows.col(column);
+	}
+}
+
+const vector<int>& FlatTree::hands(int node) const
+{
+	return *_hands[node];
+}
+
+const HandColumns& FlatTree::hand_columns(int node) const
+{
+	return *_hand_columns[node];
+}
+
+ArrayXX FlatTree::export_row(AmAxx plane, int node)
+{
+	if (!compact)
+	{
+		return plane.row(node);
+	}
+
+	const vector<int>& node_hands = hands(node);
+	ArrayXX out = ArrayXX::Zero(1, columns_count);
+
+	for (size_t column = 0; column < node_hands.size(); column++)
+	{
+		out(0, node_hands[column]) = plane(node, column);
+	}
+
+	return out;
+}
+
+void FlatTree::fill_chance_children(AmAxx plane, AmAxx strategy, int node)
+{
+	assert(current_player[node] == chance);
+	assert(is_suit_symmetric(plane, node) && "the suit-isomorphic subtrees need ranges that do not depend on the suits");
+	const int first = first_child[node];
+	const int actions_count = children_count[node];
+
+	if (!compact)
+	{
+		plane.middleRows(first, actions_count) = strategy.middleRows(first, actions_count).rowwise() * plane.row(node);
+		return;
+	}
+
+	//--the probabilities of the boards are actions of the chance node, so they are in its hand space
+	const HandColumns& columns = hand_columns(node);
+
+	for (int child = first; child < first + actions_count; child++)
+	{
+		const vector<int>& child_hands = hands(child);
+
+		for (size_t column = 0; column < child_hands.size(); column++)
+		{
+			const int node_column = columns[child_hands[column]];
+			assert(node_column >= 0 && "the board of a child holds the board of its parent");
+			plane(child, column) = strategy(child, node_column) * plane(node, node_column);
+		}
+	}
+}
+
+void FlatTree::sum_chance_children(AmAxx plane, int node)
+{
+	assert(current_player[node] == chance);
+	const int first = first_child[node];
+	const int actions_count = children_count[node];
+
+	if (compact)
+	{
+		//--every hand of a child board is a column of the node, the suit permutations map boards of the same size
+		const HandColumns& columns = hand_columns(node);
+		plane.row(node).setZero();
+
+		for (int child = first; child < first + actions_count; child++)
+		{
+			const vector<int>& child_hands = hands(child);
+
+			if (suit_permutations[child].empty())
+			{
+				for (size_t column = 0; column < child_hands.size(); column++)
+				{
+					plane(node, columns[child_hands[column]]) += plane(child, column);
+				}
+
+				continue;
+			}
+
+			for (const CardPermutation& permutation : suit_permutations[child])
+			{
+				for (size_t column = 0; column < child_hands.size(); column++)
+				{
+					plane(node, columns[permutation[child_hands[column]]]) += plane(child, column);
+				}
+			}
+		}
+
+		return;
+	}
+
+	if (suit_permutations[first].empty())
+	{
+		plane.row(node) = plane.middleRows(first, actions_count).colwise().sum();
+		return;
+	}
+
+	//--the value of the hand `permutation[hand]` on the permuted board is the value of `hand` on the child board
+	AmAxx out = situations(plane, node);
+	out.setZero();
+
+	for (int child = first; child < first + actions_count; child++)
+	{
+		AmAxx values = situations(plane, child);
+
+		for (const CardPermutation& permutation : suit_permutations[child])
+		{
+			for (int hand = 0; hand < card_count; hand++)
+			{
+				out.col(permutation[hand]) += values.col(hand);
+			}
+		}
+	}
+}
+
+bool FlatTree::is_suit_symmetric(AmAxx plane, int node)
+{
+	assert(current_player[node] == chance);
+	const int first = first_child[node];
+	const int actions_count = children_count[node];
+	const HandColumns& columns = hand_columns(node);
+	AmAxx rows = situations(plane, node);
+
+	for (int child = first; child < first + actions_count; child++)
+	{
+		//--only the hands that the board of the child does not block are carried to its class
+		const vector<int>& child_hands = _card_tools.get_possible_hands(CardSet(board(child)));
+
+		for (const CardPermutation& permutation : suit_permutations[child])
+		{
+			for (int situation = 0; situation < batch_size; situation++)
+			{
+				const float tolerance = 0.001f * rows.row(situation).abs().maxCoeff();
+
+				for (int hand : child_hands)
+				{
+					assert(columns[hand] >= 0 && columns[permutation[hand]] >= 0 && "the suit permutations keep the board of the node");
+
+					if (abs(rows(situation, columns[permutation[hand]]) - rows(situation, columns[hand])) > tolerance)
+					{
+						return false;
+					}
+				}
+			}
+		}
+	}
+
+	return true;
+}
+
+AmAxx FlatTree::situations(AmAxx plane, int node)
+{
+	assert(plane.cols() == columns_count);
+	return AmAxx(plane.data() + (size_t)node * columns_count, batch_size, card_count);
+}
+
+const ArrayX& FlatTree::board(int node)
+{
+	return nodes[node]->board;
+}
+
+void FlatTree::export_to_nodes()
+{
+	for (int i = 0; i < nodes_count; i++)
+	{
+		Node* node = nodes[i];
+		node->ranges.resize(players_count, columns_count);
+		node->ranges.row(P1) = export_row(ranges(P1), i);
+		node->ranges.row(P2) = export_row(ranges(P2), i);
+
+		node->cf_values.resize(players_count, columns_count);
+		node->cf_values.row(P1) = export_row(cf_values(P1), i);
+		node->cf_values.row(P2) = export_row(cf_values(P2), i);
+
+		node->cf_values_br.resize(players_count, columns_count);
+		node->cf_values_br.row(P1) = export_row(cf_values_br(P1), i);
+		node->cf_values_br.row(P2) = export_row(cf_values_br(P2), i);
+
+		if (children_count[i] > 0)
+		{
+			//--the hands blocked by the board play uniformly
+			_export_actions(strategy(), i, node->strategy, 1.0f / children_count[i]);
+
+			if (current_player[i] != chance)
+			{
+				_export_actions(regrets(), i, node->regrets, 0);
+			}
+		}
+	}
+}
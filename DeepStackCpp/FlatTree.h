@@ -0,0 +1,253 @@
+#pragma once
+#include "Node.h"
+#include "card_tools.h"
+#include "assert.h"
+
+#include <vector>
+#include <Eigen/Dense>
+
+using namespace std;
+using namespace Eigen;
+
+//-- - A flat, index addressed copy of a public tree built by @{tree_builder}.
+//--
+//-- Nodes are numbered in breadth first order, so the root has index 0, every
+//-- parent comes before its children and the children of a node occupy a
+//-- contiguous range of indexes. A forward pass over the tree is a loop over
+//-- increasing indexes and a backward pass is a loop over decreasing ones.
+//--
+//-- The structure of the tree is kept in plain vectors, one entry per node. All
+//-- the per node payloads live in a single arena of [nodes_count x card_count]
+//-- planes. Payloads that belong to an action (strategy, regrets) are stored in
+//-- the row of the child the action leads to, so the AxK block of a node is
+//-- `payload.middleRows(first_child[node], children_count[node])`.
+//--
+//-- A tree can hold a batch of independent situations that share its shape. The
+//-- row of a node then holds the [batch_size x card_count] payload of all the
+//-- situations one after another, so the per node kernels work on the whole
+//-- batch at once.
+//--
+//-- A compact tree keeps in the row of a node only the hands that its board does
+//-- not block, in the order of @{card_tools.get_possible_hands}, so the kernels of
+//-- a board can stop at the first @{width} columns. The other columns hold no hand,
+//-- the ranges and the values stay zero there, so the elementwise kernels may as
+//-- well run over whole rows, which are contiguous. The payloads of a node use the
+//-- hands of its own board and the payloads of an action the hands of the node
+//-- that takes it, so a chance node and its children are the only rows in different
+//-- hand spaces: @{fill_chance_children} gathers the hands going down and
+//-- @{sum_chance_children} scatters them back.
+class FlatTree
+{
+public:
+	//-- - Flattens the tree.
+	//-- @param root the root of a tree built by @{tree_builder}. Strategies and regrets
+	//-- that are already saved in the nodes are copied into the arena, the ones of a
+	//-- single situation are copied to every situation of the batch.
+	//-- @param[opt] batch_size the number of situations solved on the tree(default 1)
+	//-- @param[opt] compact whether the rows only keep the possible hands of the board(default false),
+	//-- which requires a single situation
+	FlatTree(Node& root, int batch_size = 1, bool compact = false);
+
+	// The number of nodes in the tree
+	int nodes_count;
+
+	// The number of situations that share the tree
+	int batch_size;
+
+	// The number of columns of every payload plane, batch_size x card_count
+	int columns_count;
+
+	// Whether the rows of the nodes only keep the possible hands of their boards
+	bool compact;
+
+	// The number of columns used by the payloads of the node: columns_count, or the number
+	// of possible hands of its board in a compact tree. The other columns stay zero.
+	vector<int> width;
+
+	// The source nodes. Used to export results back to the @{Node} graph.
+	vector<Node*> nodes;
+
+	// Index of the parent node. -1 for the root.
+	vector<int> parent;
+
+	// Index of the first child. Children of a node are stored one after another.
+	vector<int> first_child;
+
+	// The number of children(actions) of the node
+	vector<int> children_count;
+
+	// Index of the node among its siblings
+	vector<int> child_id;
+
+	// Type of the node
+	vector<node_types> type;
+
+	// Is node a terminal node
+	vector<char> terminal;
+
+	// The player acting at the node
+	vector<int> current_player;
+
+	// The current betting round
+	vector<int> street;
+
+	// Half the pot size
+	vector<float> pot;
+
+	// The number of chips that each player has committed to the pot. [nodes_count x players_count]
+	ArrayXX bets;
+
+	// Zero for the fold that is masked out because there is a free call
+	vector<float> fold_mask;
+
+	// Index of the board(@{card_tools.get_board_index}), -1 for an empty board
+	vector<int> board_index;
+
+	// Depth of the node inside the tree
+	vector<int> depth;
+
+	// Index of the first node of every depth level. The last element is nodes_count.
+	vector<int> level_start;
+
+	// Permutations that map the board of a suit-isomorphic chance child to its whole class, see @{Node.suit_permutations}
+	vector<vector<CardPermutation>> suit_permutations;
+
+	//-- - The probabilities of the player reaching each node with each private hand. [nodes_count x columns_count]
+	AmAxx ranges(int player);
+
+	//-- - Counterfactual values of the player at each node. [nodes_count x columns_count]
+	AmAxx cf_values(int player);
+
+	//-- - Best response counterfactual values of the player at each node. [nodes_count x columns_count]
+	AmAxx cf_values_br(int player);
+
+	//-- - The average(or the given) strategy. Row `i` is the probability of the action that leads to node `i`.
+	AmAxx strategy();
+
+	//-- - The strategy of the current iteration. Indexed as @{strategy}.
+	AmAxx current_strategy();
+
+	//-- - Cumulative regrets of the actions. Indexed as @{strategy}.
+	AmAxx regrets();
+
+	//-- - Sum of reach probabilities of the acting player used to average the strategy. [nodes_count x columns_count]
+	AmAxx reach_sum();
+
+	//-- - Opponent reach of a pruned action summed over the iterations it was skipped. Indexed as @{strategy}.
+	AmAxx pruned_reach();
+
+	//-- - Views the row of a node as one range per situation.
+	//-- @param plane one of the payload planes
+	//-- @param node the index of the node
+	//-- @return [batch_size x card_count] map of the row
+	AmAxx situations(AmAxx plane, int node);
+
+	//-- - Gives the hand of every used column of the node, every hand unless the tree is compact.
+	const vector<int>& hands(int node) const;
+
+	//-- - Gives the column of every hand in the row of the node, -1 for the hands that its board blocks.
+	const HandColumns& hand_columns(int node) const;
+
+	//-- - Copies a payload over all the hands into the row of a node.
+	//-- @param plane one of the payload planes
+	//-- @param node the index of the node
+	//-- @param values [1 x columns_count] payload over all the hands
+	template <typename Derived>
+	void import_row(AmAxx plane, int node, const ArrayBase<Derived>& values)
+	{
+		assert(values.size() == columns_count);
+
+		if (!compact)
+		{
+			plane.row(node) = values;
+			return;
+		}
+
+		const vector<int>& node_hands = hands(node);
+		plane.row(node).setZero();
+
+		for (size_t column = 0; column < node_hands.size(); column++)
+		{
+			plane(node, column) = values(node_hands[column]);
+		}
+	}
+
+	//-- - Gives the row of a node over all the hands, the ones blocked by its board are zero.
+	//-- @param plane one of the payload planes
+	//-- @param node the index of the node
+	//-- @return [1 x columns_count] payload over all the hands
+	ArrayXX export_row(AmAxx plane, int node);
+
+	//-- - Fills the rows of the children of a chance node with the row of the node times the probabilities of the boards.
+	//--
+	//--A suit-isomorphic child gets the range of its own board only, which stands for the ranges of its whole
+	//-- class just when they do not depend on the suits, see @{is_suit_symmetric}.
+	//-- @param plane one of the range planes
+	//-- @param strategy the plane with the probabilities of the chance actions
+	//-- @param node the index of the chance node
+	void fill_chance_children(AmAxx plane, AmAxx strategy, int node);
+
+	//-- - Sums the payloads of the children of a chance node into the node.
+	//--
+	//--The payload of a suit-isomorphic child is added once for every board of its
+	//-- class, with the hands permuted accordingly.
+	//-- @param plane one of the value planes
+	//-- @param node the index of the chance node
+	void sum_chance_children(AmAxx plane, int node);
+
+	//-- - Checks that the range of a chance node maps onto itself through the suit permutations of its children.
+	//--
+	//--The subtree of a suit-isomorphic child is solved once for its whole class, which is only exact when
+	//-- every hand reaches the node as its images under the permutations do, up to the rounding.
+	//-- @param plane one of the range planes
+	//-- @param node the index of the chance node
+	//-- @return `false` if a permuted hand of a situation differs by more than a thousandth of its largest range
+	bool is_suit_symmetric(AmAxx plane, int node);
+
+	//-- - Returns the board of the node.
+	const ArrayX& board(int node);
+
+	//-- - Copies ranges, counterfactual values, strategies and regrets back to the
+	//-- fields of the source nodes.
+	void export_to_nodes();
+
+private:
+
+	// Payload planes inside the arena
+	enum Planes
+	{
+		RangesP1 = 0,
+		RangesP2,
+		CfValuesP1,
+		CfValuesP2,
+		CfValuesBrP1,
+		CfValuesBrP2,
+		Strategy,
+		CurrentStrategy,
+		Regrets,
+		ReachSum,
+		PrunedReach,
+		PlanesCount
+	};
+
+	// All the payloads. [PlanesCount x nodes_count x columns_count]
+	ArrayX _arena;
+
+	card_tools _card_tools;
+
+	// The possible hands of the board of every node and their columns, see @{hands}
+	vector<const vector<int>*> _hands;
+	vector<const HandColumns*> _hand_columns;
+
+	AmAxx _plane(int plane);
+
+	//-- - Copies saved action payloads of a node into the rows of its children.
+	//-- @param values [actions_count x card_count] payloads of a single situation or [actions_count x columns_count] ones of the batch
+	void _import_actions(AmAxx plane, int node, const ArrayXX& values);
+
+	//-- - Copies the action payloads of a node out of the rows of its children.
+	//--
+	//--The hands that the board blocks keep the values that they had, or get `blocked_value`.
+	//-- @param values [actions_count x columns_count] payloads to fill
+	void _export_actions(AmAxx plane, int node, ArrayXX& values, float blocked_value);
+};
@@ -0,0 +1,33 @@
+#include "GameContext.h"
+
+const unordered_map<int, string>& GameContext::card_names()
+{
+	static const unordered_map<int, string> names = []()
+	{
+		unordered_map<int, string> out;
+		for (int card = 0; card < card_count; card++)
+		{
+			out[card] = string(1, rank_name(card_to_rank(card))) + suit_name(card_to_suit(card));
+		}
+
+		return out;
+	}();
+
+	return names;
+}
+
+const unordered_map<string, int>& GameContext::card_numbers()
+{
+	static const unordered_map<string, int> numbers = []()
+	{
+		unordered_map<string, int> out;
+		for (const auto& name : card_names())
+		{
+			out[name.second] = name.first;
+		}
+
+		return out;
+	}();
+
+	return numbers;
+}
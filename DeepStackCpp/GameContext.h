@@ -0,0 +1,53 @@
+#pragma once
+#include "game_settings.h"
+#include "assert.h"
+
+#include <string>
+#include <unordered_map>
+
+using namespace std;
+
+//-- - Immutable card tables of the game, shared by the whole process.
+//--
+//--Ranks, suits and their names are computed at compile time, the card names are built
+//-- on the first use. @{card_to_string_conversion} and @{card_tools} read these tables
+//-- and hold no state of their own, so constructing them costs nothing.
+class GameContext
+{
+public:
+	//-- - Gets the rank of a card.
+	//-- @param card the numeric representation of the card
+	//-- @return the index of the rank
+	static constexpr int card_to_rank(int card)
+	{
+		return card / suit_count;
+	}
+
+	//-- - Gets the suit of a card.
+	//-- @param card the numeric representation of the card
+	//-- @return the index of the suit
+	static constexpr int card_to_suit(int card)
+	{
+		return card % suit_count;
+	}
+
+	//-- - Gives the name of a rank, only the first ranks are used in Leduc Hold'em and variants.
+	static constexpr char rank_name(int rank)
+	{
+		return "AKQJT98765432"[rank];
+	}
+
+	//-- - Gives the name of a suit. Suits are ordered as in the original implementation.
+	static constexpr char suit_name(int suit)
+	{
+		return "shcd"[suit];
+	}
+
+	//-- - Gives the string representation of every card, indexed by its numeric representation.
+	static const unordered_map<int, string>& card_names();
+
+	//-- - Gives the numeric representation of every card, indexed by its string representation.
+	static const unordered_map<string, int>& card_numbers();
+};
+
+static_assert(rank_count <= 13 && suit_count <= 4, "the game has more cards than the card names");
@@ -56,7 +56,7 @@ ArrayX LeducEvaluator::evaluate(const ArrayX& hand, const ArrayX& impossible_han
 {
 	assert(hand.maxCoeff() <= card_count && hand.minCoeff() >= 0 && "hand does not correspond to any cards");
 
-	if (!_card_tools.hand_is_possible(hand))
+	if (!card_tools().hand_is_possible(hand))
 	{
 		return impossible_hand_value;
 	}
@@ -64,7 +64,7 @@ ArrayX LeducEvaluator::evaluate(const ArrayX& hand, const ArrayX& impossible_han
 	ArrayX hand_ranks = ArrayX(hand.size());
 	for (int i = 0; i < hand_ranks.size(); i++)
 	{
-		hand_ranks(i) = (float)_card_to_string.card_to_rank((int)hand(i));
+		hand_ranks(i) = (float)GameContext::card_to_rank((int)hand(i));
 	}
 
 	sort(hand_ranks.data(), hand_ranks.data() + hand_ranks.size());
@@ -102,20 +102,31 @@ ArrayX LeducEvaluator::batch_eval(const ArrayX& board, const ArrayX& impossible_
 	}
 	else
 	{
-		assert(board_size == 1 || board_size == 2 && "Incorrect board size for Leduc");
-		ArrayX whole_hand = ArrayX(board_size + 1);
-		memcpy(whole_hand.data(), board.data(), board.size() * sizeof(float));  //copy data to the beginning
+		assert(board_size == board_card_count && "Incorrect board size for the game");
+		const CardSet board_cards(board);
 
 		for (int card = 0; card < card_count; card++)
 		{
-			whole_hand(board_size) = (float)card;
-			hand_values.row(card) = evaluate(whole_hand, impossible_hand_value);
+			const float strength = hand_strength(board_cards, card);
+			hand_values(card) = strength == leduc_strengths::impossible_hand_value ? impossible_hand_value(0) : strength;
 		}
 	}
 
 	return hand_values;
 }
 
+float LeducEvaluator::hand_strength(const CardSet& board, int card)
+{
+	assert(board.size() == board_card_count && "Incorrect board size for the game");
+	int board_index = 0;
+	for (int i = 0; i < board.size(); i++)
+	{
+		board_index = board_index * card_count + board[i];
+	}
+
+	return leduc_strengths::table[board_index * card_count + card];
+}
+
 // Warning is it ok to use -1 as DEFAULT_IMPOSSIBLE_HAND_VALUE?
 ArrayX LeducEvaluator::batch_eval(const ArrayX& board)
 {
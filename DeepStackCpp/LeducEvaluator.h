@@ -5,11 +5,71 @@
 #include "assert.h"
 #include <Eigen/Dense>
 #include <algorithm>
+#include <array>
+#include <utility>
 #include "game_settings.h"
 
 using namespace std;
 using namespace Eigen;
 
+//-- - Compile time strengths of the private cards on the full boards of the game, see @{LeducEvaluator.hand_strength}.
+namespace leduc_strengths
+{
+// The strength of a private card that is on the board
+constexpr float impossible_hand_value = -1;
+
+//--the same values as @{LeducEvaluator.evaluate_two_card_hand} and @{LeducEvaluator.evaluate_three_card_hand}, on ranks counted from one
+constexpr float two_card_value(int low_rank, int high_rank)
+{
+	return low_rank == high_rank ? (float)low_rank : (float)(low_rank * rank_count + high_rank);
+}
+
+constexpr float three_card_value(int low_rank, int middle_rank, int high_rank)
+{
+	return low_rank == middle_rank ? (float)(low_rank * rank_count + high_rank)
+		: middle_rank == high_rank ? (float)(middle_rank * rank_count + low_rank)
+		: (float)(low_rank * rank_count * rank_count + middle_rank * rank_count + high_rank);
+}
+
+constexpr int rank(int card)
+{
+	return card / suit_count + 1;
+}
+
+constexpr float two_card_strength(int board_card, int card)
+{
+	return board_card == card ? impossible_hand_value
+		: two_card_value(min(rank(board_card), rank(card)), max(rank(board_card), rank(card)));
+}
+
+constexpr float three_card_strength(int first, int second, int card)
+{
+	return first == second || first == card || second == card ? impossible_hand_value
+		: three_card_value(min(min(rank(first), rank(second)), rank(card)),
+			rank(first) + rank(second) + rank(card) - min(min(rank(first), rank(second)), rank(card)) - max(max(rank(first), rank(second)), rank(card)),
+			max(max(rank(first), rank(second)), rank(card)));
+}
+
+// The number of ordered boards of `board_card_count` cards, repeated cards included
+const int boards_count = board_card_count == 1 ? card_count : card_count * card_count;
+
+//--entry `board * card_count + card` of @{table}, the board cards are the digits of `board` in base `card_count`
+constexpr float table_entry(int index)
+{
+	return board_card_count == 1 ? two_card_strength(index / card_count, index % card_count)
+		: three_card_strength(index / card_count / card_count, index / card_count % card_count, index % card_count);
+}
+
+template <size_t... Indexes>
+constexpr std::array<float, sizeof...(Indexes)> make_table(index_sequence<Indexes...>)
+{
+	return { { table_entry((int)Indexes)... } };
+}
+
+// Strength of every private card on every board, computed at compile time
+constexpr std::array<float, boards_count * card_count> table = make_table(make_index_sequence<boards_count * card_count>());
+}
+
 class LeducEvaluator
 {
 public:
@@ -35,6 +95,8 @@ public:
 	ArrayX evaluate(const ArrayX& hand, const ArrayX& impossible_hand_value);
 
 	//-- - Gives strength representations for all private hands on the given board.
+	//	--
+	//	--The strengths of the non - empty boards are looked up in @{leduc_strengths.table}.
 	//	-- @param board a possibly empty vector of board cards
 	//	-- on the board
 	//	-- @return a vector containing a strength value or `impossible_hand_value` for
@@ -43,9 +105,10 @@ public:
 
 	ArrayX batch_eval(const ArrayX& board);
 
-private:
-
-	card_tools _card_tools;
-	card_to_string_conversion _card_to_string;
+	//-- - Gives the strength of a private card on a full board, the same as @{evaluate}.
+	//-- @param board the board cards, `board_card_count` of them
+	//-- @param card the private card
+	//-- @return the strength value, or @{leduc_strengths.impossible_hand_value} if the card is on the board
+	static float hand_strength(const CardSet& board, int card);
 };
 
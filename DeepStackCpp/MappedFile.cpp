@@ -0,0 +1,95 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile()
+{
+}
+
+MappedFile::~MappedFile()
+{
+	close();
+}
+
+bool MappedFile::open(const string& path)
+{
+	close();
+
+#ifdef _WIN32
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	LARGE_INTEGER file_size;
+	HANDLE mapping = GetFileSizeEx(file, &file_size) && file_size.QuadPart > 0 ? CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL) : NULL;
+	CloseHandle(file);
+
+	if (mapping == NULL)
+	{
+		return false;
+	}
+
+	//--the view keeps the mapping alive
+	_data = (const char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	_size = _data == nullptr ? 0 : (uint64_t)file_size.QuadPart;
+	CloseHandle(mapping);
+#else
+	const int file = ::open(path.c_str(), O_RDONLY);
+	if (file < 0)
+	{
+		return false;
+	}
+
+	struct stat file_stat;
+	void* view = fstat(file, &file_stat) == 0 && file_stat.st_size > 0 ? mmap(nullptr, (size_t)file_stat.st_size, PROT_READ, MAP_SHARED, file, 0) : MAP_FAILED;
+	::close(file);
+
+	_data = view == MAP_FAILED ? nullptr : (const char*)view;
+	_size = _data == nullptr ? 0 : (uint64_t)file_stat.st_size;
+#endif
+
+	return _data != nullptr;
+}
+
+void MappedFile::close()
+{
+	if (_data == nullptr)
+	{
+		return;
+	}
+
+#ifdef _WIN32
+	UnmapViewOfFile(_data);
+#else
+	munmap((void*)_data, (size_t)_size);
+#endif
+
+	_data = nullptr;
+	_size = 0;
+}
+
+bool MappedFile::is_open() const
+{
+	return _data != nullptr;
+}
+
+const char* MappedFile::data() const
+{
+	return _data;
+}
+
+uint64_t MappedFile::size() const
+{
+	return _size;
+}
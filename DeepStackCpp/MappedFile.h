@@ -0,0 +1,41 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+using namespace std;
+
+//-- - Read-only memory mapping of a whole file.
+//--
+//-- The processes that map the same file share its pages, and the pages are read
+//-- from the disk only when they are touched.
+class MappedFile
+{
+public:
+	MappedFile();
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	//-- - Maps a file, unmapping the previous one.
+	//-- @param path the file to map
+	//-- @return `false` if the file is missing or empty
+	bool open(const string& path);
+
+	//-- - Unmaps the file. The pointers into it must not be used afterwards.
+	void close();
+
+	bool is_open() const;
+
+	//-- @return the first byte of the file, null if no file is mapped
+	const char* data() const;
+
+	//-- @return the size of the file in bytes
+	uint64_t size() const;
+
+private:
+
+	const char* _data = nullptr;
+
+	uint64_t _size = 0;
+};
@@ -34,9 +34,6 @@ struct Node
 
 	int childId;
 
-	//Tensor like <player/[actions, ranges]>
-	Ranges children_ranges_absolute[players_count];
-
 	// The player acting at the node
 	int current_player;
 
@@ -67,11 +64,13 @@ struct Node
 	// `i`th child for either player when that player holds the `j`th card.
 	ArrayXX strategy;
 
-	ArrayXX current_strategy; //Do we need this?
-
 	// A list of children nodes
 	vector<Node*> children;
 
+	// For a child of a chance node built with suit isomorphism: the card permutations that map
+	// its board to every board of its suit-isomorphic class, the identity included. Empty otherwise.
+	vector<CardPermutation> suit_permutations;
+
 	// Actions
 	ArrayX actions;
 
@@ -81,8 +80,6 @@ struct Node
 	// Player regrets. A tensor of [actions_count x card_count] size.
 	ArrayXX regrets;
 
-	ArrayXX regrets_sum;
-
 	// A 2xK tensor containing the probabilities of each
 	// player reaching the current node with each private hand
 	Ranges ranges;
@@ -92,8 +89,6 @@ struct Node
 	//--each other. [players_count X card_count]
 	ArrayXX cf_values;
 
-	CFVS cf_values_allactions[players_count];
-
 	//-- The cfvs for a best response against each player in the profile
 	ArrayXX cf_values_br;
 
@@ -103,12 +98,6 @@ struct Node
 	// CFV-BR values weighted by the reach prob
 	ArrayXX cfv_br_infset;
 
-	//Weighted sum of card ranges
-	ArrayX iter_weight_sum;
-
-	//Weighted current card ranges contribution;
-	ArrayX iter_weight_contribution;
-
 	// Difference between CFV-BR and Counterfactual values = node.cfv_br_infset - node.cfv_infset
 	ArrayXX epsilon;
 
@@ -2,28 +2,43 @@
 
 
 
-Resolving::Resolving()
+Resolving::Resolving(bool layers) : _layers(layers)
 {
 }
 
 
 Resolving::~Resolving()
 {
-	if (_lookahead_tree != nullptr)
-	{
-		delete(_lookahead_tree);
-		_lookahead_tree = nullptr;
-	}
+	_release_lookahead();
+}
 
+void Resolving::_release_lookahead()
+{
+	//--the lookaheads refer to the tree, so they go first
 	if (_lookahead != nullptr)
 	{
 		delete(_lookahead);
 		_lookahead = nullptr;
 	}
+
+	if (_layer_lookahead != nullptr)
+	{
+		delete(_layer_lookahead);
+		_layer_lookahead = nullptr;
+	}
+
+	if (_lookahead_tree != nullptr)
+	{
+		delete(_lookahead_tree);
+		_lookahead_tree = nullptr;
+	}
 }
 
 void Resolving::_create_lookahead_tree(Node & node)
 {
+	//--a resolver is reused for many nodes, the lookahead of the previous one is released
+	_release_lookahead();
+
 	TreeBuilderParams build_tree_params;
 	build_tree_params.root_node = &node;
 	build_tree_params.limit_to_street = true;
@@ -34,12 +49,40 @@ void Resolving::_create_lookahead_tree(Node & node)
 LookaheadResult Resolving::resolve_first_node(Node& node, const Range& player_range, const ArrayX& opponent_range)
 {
 	_create_lookahead_tree(node);
+
+	if (_layers)
+	{
+		_layer_lookahead = new lookahead(*_lookahead_tree);
+		_layer_lookahead->resolve_first_node(player_range, opponent_range);
+		_resolve_results = _layer_lookahead->get_results();
+		return _resolve_results;
+	}
+
 	_lookahead = new TreeLookahed(*_lookahead_tree);
 	_lookahead->resolve_first_node(player_range, opponent_range);
 	_resolve_results = _lookahead->get_results();
 	return _resolve_results;
 }
 
+vector<LookaheadResult> Resolving::resolve_first_node_batch(Node& node, const Ranges& player_ranges, const Ranges& opponent_ranges)
+{
+	assert(player_ranges.rows() == opponent_ranges.rows());
+	const int batch_size = (int)player_ranges.rows();
+
+	_create_lookahead_tree(node);
+	_lookahead = new TreeLookahed(*_lookahead_tree, cfr_skip_iters, cfr_iters, batch_size);
+	_lookahead->resolve_first_node_batch(player_ranges, opponent_ranges);
+
+	vector<LookaheadResult> results(batch_size);
+	for (int situation = 0; situation < batch_size; situation++)
+	{
+		results[situation] = _lookahead->get_results(situation);
+	}
+
+	_resolve_results = results[0];
+	return results;
+}
+
 //LookaheadResult Resolving::resolve(Node& node, ArrayX& player_range, ArrayX& opponent_cfvs)
 //{
 //	assert(_cardTools.is_valid_range(ToAmxx(player_range), node.board));
@@ -55,6 +98,15 @@ LookaheadResult Resolving::resolve(Node& node, ArrayX& player_range, ArrayX& opp
 {
 	assert(_cardTools.is_valid_range(ToAmx(player_range), node.board));
 	_create_lookahead_tree(node);
+
+	if (_layers)
+	{
+		_layer_lookahead = new lookahead(*_lookahead_tree, cfr_skip_iters, iters);
+		_layer_lookahead->resolve(player_range, opponent_cfvs);
+		_resolve_results = _layer_lookahead->get_results();
+		return _resolve_results;
+	}
+
 	_lookahead = new TreeLookahed(*_lookahead_tree);
 	_lookahead->_cfr_skip_iters = cfr_skip_iters;
 	_lookahead->_cfr_iters = iters;
@@ -87,6 +139,13 @@ ArrayX Resolving::get_action_cfv(int action)
 ArrayX Resolving::get_chance_action_cfv(int action, ArrayX board)
 {
 	int action_id = _action_to_action_id(action);
+
+	if (_layers)
+	{
+		//--the layer-wise lookahead is limited to one street and has no chance actions
+		return ArrayX();
+	}
+
 	return _lookahead->get_chance_action_cfv(action_id, board);
 }
 
@@ -5,14 +5,19 @@
 #include <Eigen/Dense>
 #include "tree_builder.h"
 #include "TreeLookahed.h"
+#include "lookahead.h"
 #include "LookaheadResult.h"
+#include <vector>
 
 //-- - Implements depth - limited re - solving at a node of the game tree.
 //--Internally uses @{cfrd_gadget | CFRDGadget} TODO SOLVER
 class Resolving
 {
 public:
-	Resolving();
+	//-- - Constructor
+	//-- @param[opt] layers whether to re-solve with the layer-wise @{lookahead} instead of
+	//-- the per node @{TreeLookahed}. Batches are always solved by @{TreeLookahed}.
+	Resolving(bool layers = lookahead_layers);
 	~Resolving();
 
 	//---- - Re - solves a depth - limited lookahead using input ranges.
@@ -26,6 +31,15 @@ public:
 	//---- @param opponent_range a range vector for the opponent
 	LookaheadResult resolve_first_node(Node& node, const ArrayX& player_range, const ArrayX& opponent_range);
 
+	//---- - Re - solves a batch of situations that differ only in the ranges at the same
+	//---- public node. The situations share one lookahead and are solved together.
+	//----
+	//---- @param node the public node at which to re - solve
+	//---- @param player_ranges [batch_size x card_count] ranges of the re - solving player
+	//---- @param opponent_ranges [batch_size x card_count] ranges of the opponent
+	//---- @return the result of every situation
+	vector<LookaheadResult> resolve_first_node_batch(Node& node, const Ranges& player_ranges, const Ranges& opponent_ranges);
+
 	//---- - Re - solves a depth - limited lookahead using an input range for the player and
 	//----the @{cfrd_gadget | CFRDGadget
 	//} to generate ranges for the opponent.
@@ -105,18 +119,26 @@ public:
 
 //private:
 
-	Node* _lookahead_tree;
+	Node* _lookahead_tree = nullptr;
 
 	LookaheadResult _resolve_results;
 
 	tree_builder builder;
 
-	TreeLookahed* _lookahead;
+	TreeLookahed* _lookahead = nullptr;
+
+	// The layer-wise engine, used instead of @{_lookahead} when @{_layers} is set
+	lookahead* _layer_lookahead = nullptr;
+
+	bool _layers;
 
 	card_tools _cardTools;
 
 	//-- - Builds a depth - limited public tree rooted at a given game node.
 	//-- @param node the root of the tree
 	void _create_lookahead_tree(Node& node);
+
+	//-- - Deletes the lookahead tree and the lookahead solving it, if any.
+	void _release_lookahead();
 };
 
@@ -0,0 +1,50 @@
+#include "TerminalEquityRegistry.h"
+
+
+TerminalEquityRegistry::TerminalEquityRegistry()
+{
+}
+
+TerminalEquityRegistry& TerminalEquityRegistry::instance()
+{
+	static TerminalEquityRegistry registry;
+	return registry;
+}
+
+const terminal_equity& TerminalEquityRegistry::get(const ArrayX& board)
+{
+	lock_guard<mutex> lock(_mutex);
+
+	const uint64_t boardMask = CardSet(board).mask();
+	auto it = _equities.find(boardMask);
+
+	if (it == _equities.end())
+	{
+		EquityStore::BoardData data;
+		const bool stored = _store.find(CardSet(board), data) && (data.call_matrix != nullptr || sorted_showdown);
+		it = _equities.emplace(boardMask, unique_ptr<const terminal_equity>(stored ? new terminal_equity(board, data) : new terminal_equity(board))).first;
+	}
+
+	return *it->second;
+}
+
+void TerminalEquityRegistry::build_all()
+{
+	get(ArrayX());
+
+	ArrayXX boards = _card_tools.get_second_round_boards();
+	for (int i = 0; i < boards.rows(); i++)
+	{
+		ArrayX board = boards.row(i);
+		get(board);
+	}
+}
+
+bool TerminalEquityRegistry::load(const string& path)
+{
+	lock_guard<mutex> lock(_mutex);
+
+	//--the evaluators read from the store keep pointers into it
+	assert(!_store.is_open() && "the store is loaded once");
+	return _store.open(path);
+}
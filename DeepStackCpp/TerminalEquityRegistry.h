@@ -0,0 +1,55 @@
+#pragma once
+#include "terminal_equity.h"
+#include "EquityStore.h"
+#include "card_tools.h"
+
+#include <map>
+#include <memory>
+#include <mutex>
+
+using namespace std;
+
+//-- - Process wide cache of @{terminal_equity} evaluators, one per board.
+//--
+//-- Evaluators are keyed by the @{CardSet.mask} of the board, which does not depend on the order
+//-- of the cards, built on the first request for a board or all at once by @{build_all}, and
+//-- never modified afterwards. The returned references stay valid for the
+//-- lifetime of the process and can be shared by solvers running on different threads.
+//-- Once an @{EquityStore} is loaded, the evaluators are read from its pages instead of computed.
+class TerminalEquityRegistry
+{
+public:
+	//-- - Returns the process wide registry.
+	static TerminalEquityRegistry& instance();
+
+	//-- - Gives the evaluator for a board, building it on the first request.
+	//-- @param board a possibly empty vector of board cards
+	//-- @return an immutable @{terminal_equity} with the board already set
+	const terminal_equity& get(const ArrayX& board);
+
+	//-- - Builds the evaluators for the empty board and for every possible board,
+	//-- so later requests never pay for matrix construction.
+	void build_all();
+
+	//-- - Maps a file of precomputed equities, read by the later requests for the boards.
+	//--
+	//--The boards stored in the sorted form are computed unless @{arguments.sorted_showdown} is set.
+	//-- The file stays mapped for the lifetime of the process.
+	//-- @param path a file written by @{EquityStore.write}
+	//-- @return `false` if the file can not be used, the equities are then computed
+	bool load(const string& path);
+
+private:
+	TerminalEquityRegistry();
+
+	TerminalEquityRegistry(const TerminalEquityRegistry&) = delete;
+	TerminalEquityRegistry& operator=(const TerminalEquityRegistry&) = delete;
+
+	mutex _mutex;
+
+	card_tools _card_tools;
+
+	EquityStore _store;
+
+	map<uint64_t, unique_ptr<const terminal_equity>> _equities;
+};
@@ -0,0 +1,103 @@
+#include "ThreadPool.h"
+#include "assert.h"
+
+
+ThreadPool::ThreadPool(int threads_count) : _next_task(0)
+{
+	assert(threads_count > 0);
+
+	for (int worker = 1; worker < threads_count; worker++)
+	{
+		_workers.emplace_back(&ThreadPool::_worker_loop, this, worker);
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		lock_guard<mutex> lock(_mutex);
+		_stopping = true;
+	}
+
+	_start.notify_all();
+
+	for (thread& worker : _workers)
+	{
+		worker.join();
+	}
+}
+
+int ThreadPool::threads_count() const
+{
+	return (int)_workers.size() + 1;
+}
+
+void ThreadPool::run(int tasks_count, const function<void(int, int)>& task)
+{
+	if (_workers.empty())
+	{
+		for (int taskId = 0; taskId < tasks_count; taskId++)
+		{
+			task(taskId, 0);
+		}
+
+		return;
+	}
+
+	{
+		lock_guard<mutex> lock(_mutex);
+		_task = &task;
+		_tasks_count = tasks_count;
+		_next_task = 0;
+		_busy_workers = (int)_workers.size();
+		_generation++;
+	}
+
+	_start.notify_all();
+	_drain(0);
+
+	unique_lock<mutex> lock(_mutex);
+	_done.wait(lock, [this] { return _busy_workers == 0; });
+	_task = nullptr;
+}
+
+void ThreadPool::_worker_loop(int worker_id)
+{
+	size_t seen_generation = 0;
+
+	while (true)
+	{
+		{
+			unique_lock<mutex> lock(_mutex);
+			_start.wait(lock, [&] { return _stopping || _generation != seen_generation; });
+
+			if (_stopping)
+			{
+				return;
+			}
+
+			seen_generation = _generation;
+		}
+
+		_drain(worker_id);
+
+		bool last;
+		{
+			lock_guard<mutex> lock(_mutex);
+			last = --_busy_workers == 0;
+		}
+
+		if (last)
+		{
+			_done.notify_one();
+		}
+	}
+}
+
+void ThreadPool::_drain(int worker_id)
+{
+	for (int taskId = _next_task++; taskId < _tasks_count; taskId = _next_task++)
+	{
+		(*_task)(taskId, worker_id);
+	}
+}
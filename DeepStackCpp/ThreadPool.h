@@ -0,0 +1,64 @@
+#pragma once
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+
+using namespace std;
+
+//-- - A fixed set of worker threads that runs batches of independent tasks.
+//--
+//-- The calling thread takes part in every batch as the worker 0, so a pool of a
+//-- single thread runs the tasks inline without any synchronization.
+class ThreadPool
+{
+public:
+	//-- - Starts the workers.
+	//-- @param threads_count the number of threads that run the tasks, including the calling one
+	explicit ThreadPool(int threads_count);
+
+	~ThreadPool();
+
+	//-- - Returns the number of threads that run the tasks, including the calling one.
+	int threads_count() const;
+
+	//-- - Runs `task(task_id, worker_id)` for every task_id in [0, tasks_count) and waits for all of them.
+	//--
+	//-- Tasks are handed out dynamically, so the worker of a task is not fixed. The
+	//-- worker_id is in [0, threads_count) and is meant for indexing per thread buffers.
+	//-- @param tasks_count the number of tasks
+	//-- @param task the function that runs a single task
+	void run(int tasks_count, const function<void(int, int)>& task);
+
+private:
+
+	vector<thread> _workers;
+
+	mutex _mutex;
+
+	// Signals the workers that a new batch is ready or that the pool is stopping
+	condition_variable _start;
+
+	// Signals the calling thread that all the workers finished the batch
+	condition_variable _done;
+
+	// The batch being run
+	const function<void(int, int)>* _task = nullptr;
+	int _tasks_count = 0;
+	atomic<int> _next_task;
+
+	// The number of workers still running the current batch
+	int _busy_workers = 0;
+
+	// Incremented for every batch so the workers can tell a new batch from a spurious wakeup
+	size_t _generation = 0;
+
+	bool _stopping = false;
+
+	void _worker_loop(int worker_id);
+
+	//-- - Runs tasks of the current batch until there are none left.
+	void _drain(int worker_id);
+};
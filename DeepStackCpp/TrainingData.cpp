@@ -0,0 +1,438 @@
+#include "TrainingData.h"
+#include "game_settings.h"
+#include "arguments.h"
+
+#include <cassert>
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+#ifdef _WIN32
+#include <io.h>
+#include <share.h>
+#else
+#include <unistd.h>
+#endif
+
+static const char data_magic[8] = { 'D', 'S', 'T', 'R', 'A', 'I', 'N', '\0' };
+
+// The version of the layout, a file of another version is not opened
+static const uint32_t data_version = 1;
+
+// The type of the stored values, little endian 32 bit floats
+static const uint32_t float32_dtype = 1;
+
+// The chunks start on cache lines
+static const uint64_t chunk_alignment = 64;
+
+// The first bytes of the file, rewritten only to commit the chunks
+struct DataHeader
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t dtype;
+	uint32_t bucket_count;
+	uint32_t input_size;
+	uint32_t target_size;
+	uint32_t mask_size;
+	uint32_t chunk_rows;
+	uint32_t reserved;
+	uint64_t settings_hash;
+	uint64_t chunks_count;
+	char padding[8];
+};
+
+static_assert(sizeof(DataHeader) == chunk_alignment, "the first chunk starts on a cache line");
+
+//-- - Hashes the settings that the examples depend on, so the data of another game is not mixed in.
+static uint64_t _settings_hash()
+{
+	const long long settings[] = { suit_count, rank_count, board_card_count, players_count, ante, stack };
+
+	//--FNV-1a
+	uint64_t hash = 14695981039346656037ull;
+	const unsigned char* bytes = (const unsigned char*)settings;
+	for (size_t i = 0; i < sizeof(settings); i++)
+	{
+		hash = (hash ^ bytes[i]) * 1099511628211ull;
+	}
+
+	return hash;
+}
+
+static uint64_t _chunk_size(const TrainingDataLayout& layout)
+{
+	const uint64_t size = (uint64_t)layout.chunk_rows * (layout.input_size + layout.target_size + layout.mask_size) * sizeof(float);
+	return (size + chunk_alignment - 1) / chunk_alignment * chunk_alignment;
+}
+
+static TrainingDataLayout _header_layout(const DataHeader& header)
+{
+	TrainingDataLayout layout;
+	layout.bucket_count = header.bucket_count;
+	layout.input_size = header.input_size;
+	layout.target_size = header.target_size;
+	layout.mask_size = header.mask_size;
+	layout.chunk_rows = header.chunk_rows;
+	return layout;
+}
+
+static bool _is_valid(const DataHeader& header)
+{
+	return memcmp(header.magic, data_magic, sizeof(data_magic)) == 0
+		&& header.version == data_version
+		&& header.dtype == float32_dtype
+		&& header.settings_hash == _settings_hash()
+		&& header.chunk_rows > 0;
+}
+
+//-- - Writes the buffered data through to the disk.
+static bool _sync(FILE* file)
+{
+	if (fflush(file) != 0)
+	{
+		return false;
+	}
+
+#ifdef _WIN32
+	return _commit(_fileno(file)) == 0;
+#else
+	return fsync(fileno(file)) == 0;
+#endif
+}
+
+//-- - Opens a file that the readers can map while it is written.
+static FILE* _open(const string& path, const char* mode)
+{
+#ifdef _WIN32
+	//--unlike fopen_s, the file stays shared, and unlike fopen, it builds with the deprecation checks of /sdl
+	return _fsopen(path.c_str(), mode, _SH_DENYNO);
+#else
+	return fopen(path.c_str(), mode);
+#endif
+}
+
+static bool _seek(FILE* file, uint64_t offset)
+{
+#ifdef _WIN32
+	return _fseeki64(file, (long long)offset, SEEK_SET) == 0;
+#else
+	return fseeko(file, (off_t)offset, SEEK_SET) == 0;
+#endif
+}
+
+static bool _truncate(FILE* file, uint64_t size)
+{
+#ifdef _WIN32
+	return _chsize_s(_fileno(file), (long long)size) == 0;
+#else
+	return ftruncate(fileno(file), (off_t)size) == 0;
+#endif
+}
+
+//-- - Gives the header of a version 1.0 `.npy` file of a [rows x cols] float32 array,
+//-- padded so that the data starts on a 64 byte boundary.
+static string _npy_header(size_t rows, size_t cols)
+{
+	ostringstream dict;
+	dict << "{'descr': '<f4', 'fortran_order': False, 'shape': (" << rows << ", " << cols << "), }";
+
+	//--magic, version and header length, then the dictionary ended by a newline
+	const size_t prefix_size = 10;
+	string header = dict.str();
+	const size_t size = (prefix_size + header.size() + 1 + chunk_alignment - 1) / chunk_alignment * chunk_alignment;
+	header.append(size - prefix_size - header.size() - 1, ' ');
+	header.push_back('\n');
+
+	const uint16_t header_size = (uint16_t)header.size();
+	string prefix("\x93NUMPY\x01\x00", 8);
+	prefix.push_back((char)(header_size & 0xff));
+	prefix.push_back((char)(header_size >> 8));
+	return prefix + header;
+}
+
+bool TrainingDataLayout::operator==(const TrainingDataLayout& other) const
+{
+	return bucket_count == other.bucket_count
+		&& input_size == other.input_size
+		&& target_size == other.target_size
+		&& mask_size == other.mask_size
+		&& chunk_rows == other.chunk_rows;
+}
+
+TrainingDataWriter::TrainingDataWriter()
+{
+}
+
+TrainingDataWriter::~TrainingDataWriter()
+{
+	close();
+}
+
+bool TrainingDataWriter::open(const string& path, const TrainingDataLayout& layout)
+{
+	assert(layout.chunk_rows > 0);
+	close();
+
+	DataHeader header;
+	_file = _open(path, "r+b");
+
+	if (_file != nullptr && fread(&header, sizeof(DataHeader), 1, _file) == 1)
+	{
+		//--the examples of another layout or of another game are never overwritten
+		if (!_is_valid(header) || !(_header_layout(header) == layout))
+		{
+			close();
+			return false;
+		}
+
+		//--a torn chunk left by a crash is cut off
+		_layout = layout;
+		_chunks_count = header.chunks_count;
+		if (!_truncate(_file, sizeof(DataHeader) + _chunks_count * _chunk_size(_layout)))
+		{
+			close();
+			return false;
+		}
+
+		return true;
+	}
+
+	//--a missing or an empty file starts with no chunks
+	if (_file != nullptr)
+	{
+		fclose(_file);
+	}
+
+	_file = _open(path, "w+b");
+	if (_file == nullptr)
+	{
+		return false;
+	}
+
+	memset(&header, 0, sizeof(DataHeader));
+	memcpy(header.magic, data_magic, sizeof(data_magic));
+	header.version = data_version;
+	header.dtype = float32_dtype;
+	header.bucket_count = layout.bucket_count;
+	header.input_size = layout.input_size;
+	header.target_size = layout.target_size;
+	header.mask_size = layout.mask_size;
+	header.chunk_rows = layout.chunk_rows;
+	header.settings_hash = _settings_hash();
+	header.chunks_count = 0;
+
+	_layout = layout;
+	_chunks_count = 0;
+
+	if (fwrite(&header, sizeof(DataHeader), 1, _file) != 1 || !_sync(_file))
+	{
+		close();
+		return false;
+	}
+
+	return true;
+}
+
+void TrainingDataWriter::close()
+{
+	if (_file != nullptr)
+	{
+		fclose(_file);
+		_file = nullptr;
+	}
+}
+
+bool TrainingDataWriter::append(const ArrayXX& inputs, const ArrayXX& targets, const ArrayXX& mask)
+{
+	assert(_file != nullptr);
+	assert(inputs.rows() % _layout.chunk_rows == 0 && "the examples fill whole chunks");
+	assert(targets.rows() == inputs.rows() && mask.rows() == inputs.rows());
+	assert(inputs.cols() == _layout.input_size && targets.cols() == _layout.target_size && mask.cols() == _layout.mask_size);
+
+	const uint64_t chunk_size = _chunk_size(_layout);
+	const int chunk_rows = _layout.chunk_rows;
+	const uint64_t chunks_count = inputs.rows() / chunk_rows;
+	vector<char> chunk((size_t)chunk_size, 0);
+
+	if (!_seek(_file, sizeof(DataHeader) + _chunks_count * chunk_size))
+	{
+		return false;
+	}
+
+	for (uint64_t i = 0; i < chunks_count; i++)
+	{
+		//--the blocks are row-major, so the rows of a chunk are contiguous in every block
+		char* block = chunk.data();
+		const ArrayXX* arrays[] = { &inputs, &targets, &mask };
+		for (const ArrayXX* array : arrays)
+		{
+			const size_t block_size = chunk_rows * array->cols() * sizeof(float);
+			memcpy(block, array->data() + i * chunk_rows * array->cols(), block_size);
+			block += block_size;
+		}
+
+		if (fwrite(chunk.data(), 1, chunk.size(), _file) != chunk.size())
+		{
+			return false;
+		}
+	}
+
+	//--the data reaches the disk before the header counts it
+	if (!_sync(_file))
+	{
+		return false;
+	}
+
+	const uint64_t committed = _chunks_count + chunks_count;
+	if (!_seek(_file, offsetof(DataHeader, chunks_count)) || fwrite(&committed, sizeof(uint64_t), 1, _file) != 1 || !_sync(_file))
+	{
+		return false;
+	}
+
+	_chunks_count = committed;
+	return true;
+}
+
+size_t TrainingDataWriter::rows() const
+{
+	return (size_t)(_chunks_count * _layout.chunk_rows);
+}
+
+TrainingDataReader::TrainingDataReader()
+{
+}
+
+TrainingDataReader::~TrainingDataReader()
+{
+	close();
+}
+
+bool TrainingDataReader::open(const string& path)
+{
+	close();
+
+	if (!_file.open(path))
+	{
+		return false;
+	}
+
+	//--the chunks past the committed ones may be torn
+	const DataHeader* header = (const DataHeader*)_file.data();
+	if (_file.size() < sizeof(DataHeader) || !_is_valid(*header))
+	{
+		close();
+		return false;
+	}
+
+	_layout = _header_layout(*header);
+	_chunks_count = header->chunks_count;
+
+	if (sizeof(DataHeader) + _chunks_count * _chunk_size(_layout) > _file.size())
+	{
+		close();
+		return false;
+	}
+
+	return true;
+}
+
+void TrainingDataReader::close()
+{
+	_file.close();
+	_layout = TrainingDataLayout();
+	_chunks_count = 0;
+}
+
+bool TrainingDataReader::is_open() const
+{
+	return _file.is_open();
+}
+
+const TrainingDataLayout& TrainingDataReader::layout() const
+{
+	return _layout;
+}
+
+size_t TrainingDataReader::rows() const
+{
+	return (size_t)(_chunks_count * _layout.chunk_rows);
+}
+
+const float* TrainingDataReader::_chunk(size_t row, size_t& chunk_row) const
+{
+	assert(row < rows());
+	const size_t chunk = row / _layout.chunk_rows;
+	chunk_row = row % _layout.chunk_rows;
+	return (const float*)(_file.data() + sizeof(DataHeader) + chunk * _chunk_size(_layout));
+}
+
+const float* TrainingDataReader::inputs(size_t row) const
+{
+	size_t chunk_row;
+	const float* chunk = _chunk(row, chunk_row);
+	return chunk + chunk_row * _layout.input_size;
+}
+
+const float* TrainingDataReader::targets(size_t row) const
+{
+	size_t chunk_row;
+	const float* chunk = _chunk(row, chunk_row);
+	return chunk + _layout.chunk_rows * _layout.input_size + chunk_row * _layout.target_size;
+}
+
+const float* TrainingDataReader::mask(size_t row) const
+{
+	size_t chunk_row;
+	const float* chunk = _chunk(row, chunk_row);
+	return chunk + _layout.chunk_rows * (_layout.input_size + _layout.target_size) + chunk_row * _layout.mask_size;
+}
+
+void TrainingDataReader::read(const vector<size_t>& rows, ArrayXX& inputs, ArrayXX& targets, ArrayXX& mask) const
+{
+	const Eigen::Index count = (Eigen::Index)rows.size();
+	inputs.resize(count, _layout.input_size);
+	targets.resize(count, _layout.target_size);
+	mask.resize(count, _layout.mask_size);
+
+	for (Eigen::Index i = 0; i < count; i++)
+	{
+		inputs.row(i) = Eigen::Map<const ArrayXX>(this->inputs(rows[i]), 1, _layout.input_size);
+		targets.row(i) = Eigen::Map<const ArrayXX>(this->targets(rows[i]), 1, _layout.target_size);
+		mask.row(i) = Eigen::Map<const ArrayXX>(this->mask(rows[i]), 1, _layout.mask_size);
+	}
+}
+
+bool TrainingDataReader::export_npy(const string& prefix) const
+{
+	assert(_file.is_open());
+
+	const char* names[] = { ".inputs.npy", ".targets.npy", ".mask.npy" };
+	const int sizes[] = { _layout.input_size, _layout.target_size, _layout.mask_size };
+	size_t block_offset = 0;
+
+	for (int array = 0; array < 3; array++)
+	{
+		ofstream out(prefix + names[array], ios::out | ios::binary | ios::trunc);
+		const string header = _npy_header(rows(), sizes[array]);
+		out.write(header.data(), header.size());
+
+		//--the rows of an array are contiguous inside every chunk
+		const size_t block_size = (size_t)_layout.chunk_rows * sizes[array];
+		for (uint64_t chunk = 0; chunk < _chunks_count; chunk++)
+		{
+			const float* block = (const float*)(_file.data() + sizeof(DataHeader) + chunk * _chunk_size(_layout)) + block_offset;
+			out.write((const char*)block, block_size * sizeof(float));
+		}
+
+		block_offset += block_size;
+		out.close();
+		if (!out)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
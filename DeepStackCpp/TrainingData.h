@@ -0,0 +1,133 @@
+#pragma once
+#include "CustomSettings.h"
+#include "MappedFile.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+//-- - The shapes of the examples of a training data file.
+struct TrainingDataLayout
+{
+	// The number of buckets that the ranges and the values are over
+	int bucket_count = 0;
+
+	// The number of values of an input, a target and a mask
+	int input_size = 0;
+	int target_size = 0;
+	int mask_size = 0;
+
+	// The number of examples that a chunk holds
+	int chunk_rows = 0;
+
+	bool operator==(const TrainingDataLayout& other) const;
+};
+
+//-- - Appends examples to a training data file.
+//--
+//-- The file holds a header and a sequence of chunks of @{TrainingDataLayout.chunk_rows} examples,
+//-- each chunk storing its inputs, its targets and its masks as row-major float blocks. The chunks
+//-- are only ever appended. A chunk is committed by counting it in the header after its data is
+//-- flushed to the disk, so a crash leaves at most a torn chunk after the committed ones, which the
+//-- readers ignore and the next writer cuts off.
+class TrainingDataWriter
+{
+public:
+	TrainingDataWriter();
+	~TrainingDataWriter();
+
+	TrainingDataWriter(const TrainingDataWriter&) = delete;
+	TrainingDataWriter& operator=(const TrainingDataWriter&) = delete;
+
+	//-- - Opens a file to append to, creating it if it does not exist.
+	//-- @param path the file
+	//-- @param layout the shapes of the examples
+	//-- @return `false` if the file could not be written, or exists with another layout or for another game
+	bool open(const string& path, const TrainingDataLayout& layout);
+
+	void close();
+
+	//-- - Appends examples and commits them.
+	//-- @param inputs [N x input_size] inputs, N a multiple of the chunk rows
+	//-- @param targets [N x target_size] targets
+	//-- @param mask [N x mask_size] masks
+	//-- @return `false` if the examples could not be written, the file then keeps the committed ones
+	bool append(const ArrayXX& inputs, const ArrayXX& targets, const ArrayXX& mask);
+
+	//-- @return the number of committed examples in the file
+	size_t rows() const;
+
+private:
+
+	FILE* _file = nullptr;
+
+	TrainingDataLayout _layout;
+
+	uint64_t _chunks_count = 0;
+};
+
+//-- - Random access to the examples of a training data file, without loading it.
+//--
+//-- The file is mapped, so the examples are read from the disk only when they are used, and the
+//-- files larger than the memory can be streamed. The reader sees the chunks committed when it was
+//-- opened, a writer may keep appending meanwhile.
+class TrainingDataReader
+{
+public:
+	TrainingDataReader();
+	~TrainingDataReader();
+
+	TrainingDataReader(const TrainingDataReader&) = delete;
+	TrainingDataReader& operator=(const TrainingDataReader&) = delete;
+
+	//-- - Maps a file written by @{TrainingDataWriter}.
+	//-- @param path the file
+	//-- @return `false` if the file is missing, or was written by another version or for another game
+	bool open(const string& path);
+
+	void close();
+
+	bool is_open() const;
+
+	const TrainingDataLayout& layout() const;
+
+	//-- @return the number of examples in the file
+	size_t rows() const;
+
+	//-- - Gives the values of an example, pointing into the mapped file.
+	//-- @param row the index of the example
+	//-- @return input_size, target_size or mask_size values
+	const float* inputs(size_t row) const;
+	const float* targets(size_t row) const;
+	const float* mask(size_t row) const;
+
+	//-- - Gathers a batch of examples.
+	//-- @param rows the indices of the examples
+	//-- @param[out] inputs [rows x input_size] inputs
+	//-- @param[out] targets [rows x target_size] targets
+	//-- @param[out] mask [rows x mask_size] masks
+	void read(const vector<size_t>& rows, ArrayXX& inputs, ArrayXX& targets, ArrayXX& mask) const;
+
+	//-- - Writes the examples as NumPy `.npy` files, which `numpy.load(path, mmap_mode='r')`
+	//-- maps without parsing or copying.
+	//--
+	//--The arrays are little endian float32 in C order, as the row-major @{ArrayXX}, and their
+	//-- data starts on a 64 byte boundary.
+	//-- @param prefix the prefix of the files(appended with `.inputs.npy`, `.targets.npy` and `.mask.npy`)
+	//-- @return `false` if a file could not be written
+	bool export_npy(const string& prefix) const;
+
+private:
+
+	// The start of the chunk of an example and the example inside the chunk
+	const float* _chunk(size_t row, size_t& chunk_row) const;
+
+	MappedFile _file;
+
+	TrainingDataLayout _layout;
+
+	uint64_t _chunks_count = 0;
+};
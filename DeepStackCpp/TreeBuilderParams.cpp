@@ -1,5 +1,5 @@
 #include "TreeBuilderParams.h"
 
-TreeBuilderParams::TreeBuilderParams() : street(0), bets(0), current_player(0), board(), limit_to_street(false), bet_sizing(), root_node(nullptr)
+TreeBuilderParams::TreeBuilderParams() : street(0), bets(0), current_player(0), board(), limit_to_street(false), suit_isomorphism(false), bet_sizing(), root_node(nullptr)
 {
 }
@@ -18,6 +18,10 @@ struct TreeBuilderParams
 	// if `true`, only build the current betting round
 	bool limit_to_street;
 
+	// if `true`, chance nodes get one child per class of suit-isomorphic boards instead of one per board.
+	// Requires ranges reaching the chance nodes that do not depend on the suits(e.g. uniform starting ranges), see @{FlatTree.is_suit_symmetric}.
+	bool suit_isomorphism;
+
 	// object which gives the allowed bets for each player
 	VectorX bet_sizing;
 
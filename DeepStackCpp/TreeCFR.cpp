@@ -1,290 +1,641 @@
 #include "TreeCFR.h"
 #include <iostream>
 #include <string>
+#include <algorithm>
+#include <limits>
 
 
-TreeCFR::TreeCFR(){}
+TreeCFR::TreeCFR(cfr_modes mode) : _mode(mode), _updating_player(P1) {}
 
 
 TreeCFR::~TreeCFR()
 {
-	for (auto itr = _cached_terminal_equities.begin(); itr != _cached_terminal_equities.end(); itr++)
+	if (_tree != nullptr)
 	{
-		delete itr->second;
+		delete _tree;
+		_tree = nullptr;
 	}
 
-	_cached_terminal_equities.clear();
+	if (_pool != nullptr)
+	{
+		delete _pool;
+		_pool = nullptr;
+	}
 }
 
-void TreeCFR::run_cfr(Node& root, const ArrayXX& starting_ranges, size_t iter_count, size_t skip_iters)
+void TreeCFR::run_cfr(Node& root, const ArrayXX& starting_ranges, size_t iter_count, size_t skip_iters, int threads_count)
 {
 	_cfr_skip_iters = skip_iters;
 	Util::Print(starting_ranges);
 
 	assert(starting_ranges.size() > 0);
 	assert(iter_count >= _cfr_skip_iters);
+	assert((!_pruning || _mode == cfr_vanilla) && "CFR+ floors the regrets, so they never get negative enough to prune");
 	iter_count = iter_count > 0 ? iter_count : cfr_iters;
 	root.ranges = starting_ranges;
 
-	for (size_t iter = 0; iter < iter_count; iter++)
+	if (_tree != nullptr)
 	{
-		cfrs_iter_dfs(root, iter);
+		delete _tree;
 	}
-}
 
+	//--the terminal equities only see the possible hands of every board
+	_tree = new FlatTree(root, 1, true);
+	_tree->import_row(_tree->ranges(P1), 0, starting_ranges.row(P1));
+	_tree->import_row(_tree->ranges(P2), 0, starting_ranges.row(P2));
 
-void TreeCFR::cfrs_iter_dfs(Node& node, size_t iter)
-{
-	assert(node.current_player == P1 || node.current_player == P2 || node.current_player == chance);
-	//--compute values using terminal_equity in terminal nodes
-	if (node.terminal)
+	//--initialize regrets of the nodes that were not solved before
+	for (int node = 0; node < _tree->nodes_count; node++)
 	{
-		_fillCFvaluesForTerminalNode(node);
+		if (!_tree->terminal[node] && _tree->current_player[node] != chance && _tree->nodes[node]->regrets.size() == 0)
+		{
+			_tree->regrets().middleRows(_tree->first_child[node], _tree->children_count[node]).setConstant(regret_epsilon);
+		}
 	}
-	else
+
+	//--resolve terminal equities once, the sweeps only index them
+	_terminal_equities.assign(_tree->nodes_count, nullptr);
+	for (int node = 0; node < _tree->nodes_count; node++)
 	{
-		_fillCFvaluesForNonTerminalNode(node, iter);
+		if (_tree->terminal[node])
+		{
+			_terminal_equities[node] = &TerminalEquityRegistry::instance().get(_tree->board(node));
+		}
 	}
-}
 
-void TreeCFR::_fillCFvaluesForTerminalNode(Node &node)
-{
-	assert(node.terminal && (node.type == terminal_fold || node.type == terminal_call));
-	int opponnent = 1 - node.current_player;
+	_split_tree();
 
-	terminal_equity* termEquity = _get_terminal_equity(node);
+	if (_pool == nullptr || _pool->threads_count() != threads_count)
+	{
+		delete _pool;
+		_pool = new ThreadPool(threads_count);
+	}
 
-	// CF values  2p X each private hand.
-	node.cf_values = ArrayXX::Zero(players_count, card_count);
+	//--the iterations only use the buffers sized here
+	const int max_actions_count = *max_element(_tree->children_count.begin(), _tree->children_count.end());
+	_scratch.assign(threads_count, Scratch());
 
-	if (node.type == terminal_fold)
+	for (Scratch& scratch : _scratch)
 	{
-		termEquity->tree_node_fold_value(node.ranges, node.cf_values, opponnent);
+		scratch.current_regrets.resize(max_actions_count, card_count);
+		scratch.subtree.reserve(_tree->nodes_count);
 	}
-	else
+
+	_skipped.assign(_tree->nodes_count, false);
+	_pruned_until.assign(_tree->nodes_count, 0);
+	_iter_count = iter_count;
+	_compute_regret_bounds();
+	_exploitability = -1;
+
+	for (size_t iter = 0; iter < iter_count; iter++)
 	{
-		termEquity->tree_node_call_value(node.ranges, node.cf_values);
+		Util::SetMallocAllowed(!_allocation_check || iter == 0);
+		cfrs_iter(iter);
+		Util::SetMallocAllowed(true);
+		_iterations_done = iter + 1;
+
+		if (_target_reached(iter, starting_ranges))
+		{
+			break;
+		}
 	}
 
-	//--multiply by the pot
-	node.cf_values *= node.pot;
+	//--no action may get pruned again while the last ones are brought back
+	_iter_count = _iterations_done;
+	_catch_up_pruned(_iterations_done - 1, true);
 
-	//Looks like this not needed? ToDo: check during debugging!
-	//node.cf_values.conservativeResize(node.ranges_absolute.rows(), node.ranges_absolute.cols());
+	_tree->export_to_nodes();
 }
 
 
-void TreeCFR::_fillCFvaluesForNonTerminalNode(Node &node, size_t iter)
+void TreeCFR::set_target_exploitability(float target, exploitability_units units, int check_iters)
+{
+	assert(target >= 0 && check_iters > 0);
+	_target_exploitability = target;
+	_target_units = units;
+	_exploitability_check_iters = check_iters;
+}
+
+void TreeCFR::set_regret_pruning(bool pruning, int min_iters)
 {
-	const int actions_count = (int)node.children.size();
+	assert(min_iters > 0);
+	_pruning = pruning;
+	_pruning_min_iters = min_iters;
+}
 
-	ArrayXX current_strategy;
+void TreeCFR::set_allocation_check(bool check)
+{
+	_allocation_check = check;
+}
 
+size_t TreeCFR::get_pruned_actions() const
+{
+	size_t pruned_actions = 0;
 
-	//--current cfv[[actions, players, ranges]]
-	//	Tensor<float, 3> cf_values_allactions(actions_count, players_count, card_count);
-	//[actions_count x card_count][players_count]
-	Array<float, Dynamic, card_count>  cf_values_allactions[players_count];
-	cf_values_allactions[P1] = Array<float, Dynamic, card_count>(actions_count, card_count);
-	cf_values_allactions[P2] = Array<float, Dynamic, card_count>(actions_count, card_count);
+	for (const Scratch& scratch : _scratch)
+	{
+		pruned_actions += scratch.pruned_actions;
+	}
 
-	//map <player/[actions, ranges]>
-	map <int, ArrayXX> children_ranges_absolute;
+	return pruned_actions;
+}
 
-	static const int PLAYERS_DIM = 1;
+size_t TreeCFR::get_iterations_done() const
+{
+	return _iterations_done;
+}
 
-	//cf_values_allactions.setZero();
+float TreeCFR::get_exploitability() const
+{
+	return _exploitability;
+}
 
-	if (node.current_player == chance)
+bool TreeCFR::_target_reached(size_t iter, const ArrayXX& starting_ranges)
+{
+	if (_target_exploitability <= 0 || iter < _cfr_skip_iters || (iter + 1 - _cfr_skip_iters) % _exploitability_check_iters != 0)
 	{
-		_fillChanceRangesAndStrategy(node, children_ranges_absolute, current_strategy);
+		return false;
 	}
-	else
+
+	//--the skipped opponent strategies are averaged when their action comes back
+	_catch_up_pruned(iter, true);
+
+	//--the next iteration recomputes the ranges and the values planes, so the tree itself can be evaluated
+	_exploitability = _tree_values.compute_exploitability(*_tree, starting_ranges);
+	return tree_values::to_units(_exploitability, _target_units) < _target_exploitability;
+}
+
+void TreeCFR::cfrs_iter(size_t iter)
+{
+	FlatTree& tree = *_tree;
+
+	//--CFR+ alternates the updates, the other player plays against the freshly updated strategy
+	_updating_player = _mode == cfr_plus ? (int)(iter % players_count) : chance;
+
+	if (iter > 0)
 	{
-		_fillPlayersRangesAndStrategy(node, children_ranges_absolute, current_strategy);
+		_catch_up_pruned(iter - 1, false);
 	}
 
-	for (size_t i = 0; i < node.children.size(); i++)
+	//--forward sweep: parents come before their children, so ranges flow down the tree
+	for (int node : _trunk)
 	{
-		Node* child_node = node.children[i];
-		//--set new absolute ranges(after the action) for the child
-		child_node->ranges = ArrayXX(node.ranges);
+		_forward(node, _scratch[0]);
+	}
 
-		child_node->ranges.row(P1) = children_ranges_absolute[P1].row(i);
-		child_node->ranges.row(P2) = children_ranges_absolute[P2].row(i);
-		cfrs_iter_dfs(*child_node, iter);
+	//--the subtrees below the chance nodes only read the ranges of their roots and write their own nodes
+	_pool->run((int)_subtrees.size(), [this, iter](int subtree, int worker)
+	{
+		const vector<int>& nodes = _subtrees[subtree];
 
-		// Now coping cf_values from children to calculate the regret
-		cf_values_allactions[P1].row(i) = child_node->cf_values.row(P1); //ToDo: Can be single copy operation(two rows copy)?
-		cf_values_allactions[P2].row(i) = child_node->cf_values.row(P2);
+		for (int node : nodes)
+		{
+			_forward(node, _scratch[worker]);
+		}
+
+		for (auto node = nodes.rbegin(); node != nodes.rend(); ++node)
+		{
+			_backward(*node, iter, _scratch[worker]);
+		}
+	});
 
-		//cf_values_allactions.chip(i, 0) = Util::ToTensor(child_node->cf_values);
+	//--backward sweep: children come before their parents, so values flow up the tree.
+	//--the chance nodes sum the values of their subtrees in a fixed order, so the result does not depend on the threads.
+	for (auto node = _trunk.rbegin(); node != _trunk.rend(); ++node)
+	{
+		_backward(*node, iter, _scratch[0]);
 	}
+}
 
-	node.cf_values = MatrixX(players_count, card_count);
-	node.cf_values.fill(0);
+void TreeCFR::_split_tree()
+{
+	FlatTree& tree = *_tree;
+	vector<int> subtree_of(tree.nodes_count, -1);
+	_trunk.clear();
+	_subtrees.clear();
 
-	Tensor<float, 2> tempVar;
+	for (int node = 0; node < tree.nodes_count; node++)
+	{
+		const int parent = tree.parent[node];
+
+		if (parent >= 0 && subtree_of[parent] >= 0)
+		{
+			subtree_of[node] = subtree_of[parent];
+		}
+		else if (parent >= 0 && tree.current_player[parent] == chance)
+		{
+			subtree_of[node] = (int)_subtrees.size();
+			_subtrees.emplace_back();
+		}
 
-	if (node.current_player == chance)
+		if (subtree_of[node] >= 0)
+		{
+			_subtrees[subtree_of[node]].push_back(node);
+		}
+		else
+		{
+			_trunk.push_back(node);
+		}
+	}
+}
+
+void TreeCFR::_forward(int node, Scratch& scratch)
+{
+	FlatTree& tree = *_tree;
+	assert(tree.current_player[node] == P1 || tree.current_player[node] == P2 || tree.current_player[node] == chance);
+
+	const int parent = tree.parent[node];
+	_skipped[node] = (parent >= 0 && _skipped[parent]) || _pruned_until[node] != 0 || _zero_reach(node);
+
+	if (tree.terminal[node] || _skipped[node])
 	{
-		// For the chance node just sum regrets from all cards
-		node.cf_values.row(P1) = cf_values_allactions[P1].colwise().sum();
-		node.cf_values.row(P2) = cf_values_allactions[P2].colwise().sum();
-		//node.cf_values.row(0) = Util::TensorToArray2d(cf_values_allactions, 0, PLAYERS_DIM, tempVar).colwise().sum();
-		//node.cf_values.row(1) = Util::TensorToArray2d(cf_values_allactions, 1, PLAYERS_DIM, tempVar).colwise().sum();
+		return;
+	}
+
+	if (tree.current_player[node] == chance)
+	{
+		_fillChanceRangesAndStrategy(node);
 	}
 	else
 	{
-		ArrayXX current_regrets = ComputeRegrets(node, current_strategy, cf_values_allactions);
-		update_regrets(node, current_regrets);
-		//--accumulating average strategy
-		update_average_strategy(node, current_strategy, iter);
+		_fillPlayersRangesAndStrategy(node, scratch);
+	}
+}
+
+bool TreeCFR::_zero_reach(int node)
+{
+	return (_tree->ranges(P1).row(node) <= _prune_reach).all() && (_tree->ranges(P2).row(node) <= _prune_reach).all();
+}
+
+void TreeCFR::_backward(int node, size_t iter, Scratch& scratch)
+{
+	if (_skipped[node])
+	{
+		//--only the root of a skipped subtree is read by its parent
+		const int parent = _tree->parent[node];
+		if (parent < 0 || !_skipped[parent])
+		{
+			_tree->cf_values(P1).row(node).setZero();
+			_tree->cf_values(P2).row(node).setZero();
+		}
+
+		return;
+	}
+
+	//--compute values using terminal_equity in terminal nodes
+	if (_tree->terminal[node])
+	{
+		_fillCFvaluesForTerminalNode(node, scratch);
+	}
+	else
+	{
+		_fillCFvaluesForNonTerminalNode(node, iter, scratch);
 	}
 }
 
-terminal_equity* TreeCFR::_get_terminal_equity(Node& node)
+void TreeCFR::_fillCFvaluesForTerminalNode(int node, Scratch& scratch)
 {
-	auto it = _cached_terminal_equities.find(&node.board);
+	FlatTree& tree = *_tree;
+	assert(tree.terminal[node] && (tree.type[node] == terminal_fold || tree.type[node] == terminal_call));
+	int opponnent = 1 - tree.current_player[node];
 
-	terminal_equity* cached = nullptr;
-	if (it == _cached_terminal_equities.end())
+	const terminal_equity* termEquity = _get_terminal_equity(node);
+	const int width = tree.width[node];
+
+	//--the buffers hold the possible hands of the board one row after another
+	AmAxx ranges(scratch.terminal_ranges.data(), players_count, width);
+	AmAxx values(scratch.terminal_values.data(), players_count, width);
+	ranges.row(P1) = tree.ranges(P1).row(node).leftCols(width);
+	ranges.row(P2) = tree.ranges(P2).row(node).leftCols(width);
+
+	if (tree.type[node] == terminal_fold)
 	{
-		cached = new terminal_equity();
-		cached->set_board(node.board);
-		_cached_terminal_equities[&node.board] = cached;
+		termEquity->tree_node_compact_fold_value(ranges, values, opponnent);
 	}
 	else
 	{
-		cached = it->second;
+		termEquity->tree_node_compact_call_value(ranges, values);
 	}
 
-	return cached;
+	//--multiply by the pot
+	tree.cf_values(P1).row(node).leftCols(width) = values.row(P1) * tree.pot[node];
+	tree.cf_values(P2).row(node).leftCols(width) = values.row(P2) * tree.pot[node];
 }
 
-void TreeCFR::update_regrets(Node& node, const ArrayXX& current_regrets)
+
+void TreeCFR::_fillCFvaluesForNonTerminalNode(int node, size_t iter, Scratch& scratch)
 {
-	//--node.regrets:add(current_regrets)
-	//	--local negative_regrets = node.regrets[node.regrets:lt(0)]
-	//	--node.regrets[node.regrets:lt(0)] = negative_regrets
-	node.regrets.array() += current_regrets;
+	FlatTree& tree = *_tree;
+	const int first = tree.first_child[node];
+	const int actions_count = tree.children_count[node];
 
-	node.regrets = (node.regrets.array() >= regret_epsilon).select(
-		node.regrets,
-		MatrixXd::Constant(node.regrets.rows(), node.regrets.cols(), regret_epsilon));
+	if (tree.current_player[node] == chance)
+	{
+		// For the chance node just sum values from all children
+		tree.sum_chance_children(tree.cf_values(P1), node);
+		tree.sum_chance_children(tree.cf_values(P2), node);
+	}
+	else
+	{
+		const int currentPlayer = tree.current_player[node];
+		const int opponent = 1 - currentPlayer;
+
+		AmAxx playerCfValues = tree.cf_values(currentPlayer);
+		AmAxx opponentCfValues = tree.cf_values(opponent);
+		auto childrenPlayerCfValues = playerCfValues.middleRows(first, actions_count); // [actions X cards]
+
+		opponentCfValues.row(node) = opponentCfValues.middleRows(first, actions_count).colwise().sum(); // for opponent assume that strategy is uniform
+
+		// weight the children values by the used strategy and sum over the actions
+		playerCfValues.row(node) = (tree.current_strategy().middleRows(first, actions_count) * childrenPlayerCfValues).colwise().sum();
+
+		if (_mode == cfr_plus && currentPlayer != _updating_player)
+		{
+			return;
+		}
+
+		//--computing regrets: value of every action minus the value of the node
+		AmAxx current_regrets(scratch.current_regrets.data(), actions_count, card_count);
+		current_regrets = childrenPlayerCfValues.rowwise() - playerCfValues.row(node);
+		update_regrets(node, current_regrets);
+		//--accumulating average strategy
+		update_average_strategy(node, iter, scratch);
+
+		if (_pruning)
+		{
+			//--a pruned action was charged the value of the node, the value of the action follows from the summed opponent range
+			for (int child = first; child < first + actions_count; child++)
+			{
+				if (_pruned_until[child] != 0)
+				{
+					tree.pruned_reach().row(child) += tree.ranges(opponent).row(node);
+					scratch.pruned_actions++;
+				}
+			}
+
+			_prune_actions(node, iter);
+		}
+	}
 }
 
-void TreeCFR::update_average_strategy(Node& node, ArrayXX& current_strategy, size_t iter)
+void TreeCFR::_compute_regret_bounds()
 {
-	if (iter >= _cfr_skip_iters)
+	FlatTree& tree = *_tree;
+	_pot_bound.assign(tree.nodes_count, 0);
+
+	for (int node = tree.nodes_count - 1; node >= 0; node--)
 	{
-		if (node.strategy.size() == 0)
+		if (tree.terminal[node])
 		{
-			const int actions_count = (int)node.children.size();
-			node.strategy = ArrayXX::Zero(actions_count, card_count);
+			_pot_bound[node] = tree.pot[node];
 		}
 
-		if (node.iter_weight_sum.size() == 0)
+		if (tree.parent[node] >= 0)
 		{
-			node.iter_weight_sum = ArrayX::Zero(card_count);
+			_pot_bound[tree.parent[node]] = max(_pot_bound[tree.parent[node]], _pot_bound[node]);
 		}
+	}
 
-		ArrayX iter_weight_contribution = node.ranges.row(node.current_player); 
-		Util::ClipLow(iter_weight_contribution, regret_epsilon);
-		node.iter_weight_sum += iter_weight_contribution;
+	//--only the chance nodes cut the ranges then, the first iteration overwrites them
+	for (int player = P1; player <= P2; player++)
+	{
+		AmAxx ranges = tree.ranges(player);
+		_reach_bound[player].assign(tree.nodes_count, 0);
 
-		ArrayXX iter_weight = iter_weight_contribution / node.iter_weight_sum;
-		iter_weight.resize(1, card_count);
-		ArrayXX expanded_weight = Util::ExpandAs(iter_weight, node.strategy);
-		ArrayXX old_strategy_scale = (expanded_weight * (-1)) + 1; //--same as 1 - expanded weight
-		node.strategy *= old_strategy_scale;
-		node.strategy += (current_strategy  * expanded_weight);
+		for (int node = 0; node < tree.nodes_count; node++)
+		{
+			const int first = tree.first_child[node];
+			const int actions_count = tree.children_count[node];
+
+			if (tree.current_player[node] == chance)
+			{
+				tree.fill_chance_children(ranges, tree.strategy(), node);
+			}
+			else if (actions_count > 0)
+			{
+				ranges.middleRows(first, actions_count) = ranges.row(node).replicate(actions_count, 1);
+			}
+
+			_reach_bound[player][node] = ranges.row(node).sum();
+		}
 	}
 }
 
-void TreeCFR::_fillChanceRangesAndStrategy(Node &node, map<int, ArrayXX> &children_ranges_absolute, ArrayXX& current_strategy)
+void TreeCFR::_prune_actions(int node, size_t iter)
 {
-	int actions_count = (int)node.children.size();
-	current_strategy = node.strategy;
+	FlatTree& tree = *_tree;
+	const int first = tree.first_child[node];
+	const int actions_count = tree.children_count[node];
 
-	ArrayXX ranges_mul_matrix = node.ranges.row(0).replicate(actions_count, 1);
-	children_ranges_absolute[0] = current_strategy * ranges_mul_matrix;
+	if (iter + 1 >= _iter_count)
+	{
+		return;
+	}
+
+	//--a value is at most the largest pot below times the opponent reach
+	const float reach_bound = _reach_bound[1 - tree.current_player[node]][node];
+	int active = 0;
+
+	for (int child = first; child < first + actions_count; child++)
+	{
+		active += _pruned_until[child] == 0;
+	}
+
+	for (int child = first; child < first + actions_count && active > 1; child++)
+	{
+		auto regrets = tree.regrets().row(child);
+
+		//--a terminal action costs less than bringing it back. The hands blocked by the board keep their initial regrets.
+		if (tree.terminal[child] || _pruned_until[child] != 0 || (regrets > regret_epsilon).any() || !(regrets < 0).any())
+		{
+			continue;
+		}
 
-	ranges_mul_matrix = node.ranges.row(1).replicate(actions_count, 1);
-	children_ranges_absolute[1] = current_strategy * ranges_mul_matrix;	
+		//--the regret grows by at most the largest value of the action minus the smallest value of the node per iteration
+		const float bound = (_pot_bound[child] + _pot_bound[node]) * reach_bound;
+		const float deficit = (regrets < 0).select(-regrets, numeric_limits<float>::max()).minCoeff();
+		size_t skip = min((size_t)(deficit / bound), _iter_count - iter - 1);
+
+		//--the pass that brings the action back averages all the skipped iterations or none
+		if (iter + 1 < _cfr_skip_iters)
+		{
+			skip = min(skip, _cfr_skip_iters - iter - 1);
+		}
+
+		if (skip >= _pruning_min_iters)
+		{
+			_pruned_until[child] = iter + skip + 1;
+			tree.pruned_reach().row(child).setZero();
+			active--;
+		}
+	}
 }
 
-void TreeCFR::_fillPlayersRangesAndStrategy(Node &node, map<int, ArrayXX> &children_ranges_absolute, ArrayXX& current_strategy)
+void TreeCFR::_catch_up_pruned(size_t iter, bool all)
 {
-	int currentPlayer = node.current_player; // Because we have zero based indexes, unlike the original source.
-	int opponentIndex = 1 - currentPlayer;
+	if (!_pruning)
+	{
+		return;
+	}
 
-	const int actions_count = (int)node.children.size();
+	//--in the tree order, so an action pruned inside the subtree of another one gets its share of the other's pass first
+	for (int node = 0; node < _tree->nodes_count; node++)
+	{
+		if (_pruned_until[node] != 0 && (all || _pruned_until[node] <= iter + 1))
+		{
+			_catch_up(node, iter, _scratch[0]);
+		}
+	}
+}
 
-	//--we have to compute current strategy at the beginning of each iteration
+void TreeCFR::_catch_up(int node, size_t iter, Scratch& scratch)
+{
+	FlatTree& tree = *_tree;
+	const int parent = tree.parent[node];
+	const int player = tree.current_player[parent];
+	const int opponent = 1 - player;
 
-	//--initialize regrets in the first iteration
-	if (node.regrets.size() == 0)
+	_pruned_until[node] = 0;
+
+	//--the subtree in the tree order
+	vector<int>& nodes = scratch.subtree;
+	nodes.assign(1, node);
+
+	for (size_t i = 0; i < nodes.size(); i++)
 	{
-		node.regrets = MatrixX(actions_count, card_count);
-		node.regrets.fill(regret_epsilon);
+		for (int child = 0; child < tree.children_count[nodes[i]]; child++)
+		{
+			nodes.push_back(tree.first_child[nodes[i]] + child);
+		}
 	}
 
-	assert((node.regrets >= regret_epsilon).all() && "All regrets must be positive or uncomment commented code below.");
+	//--the player did not reach the action, his values only depend on the opponent range and the strategies,
+	//--which stayed the same while the subtree was skipped
+	tree.ranges(player).row(node).setZero();
+	tree.ranges(opponent).row(node) = tree.pruned_reach().row(node);
+	_skipped[parent] = false;
 
-	//else
-	//{
-	//	//--leave positive regrets only so that we can compute the current strategy from them
-	//	Util::ClipLow(node.regrets, regret_epsilon);
-	//}
+	for (int subtree_node : nodes)
+	{
+		_forward(subtree_node, scratch);
+	}
 
-	//--compute the current strategy
-	ArrayXX regrets_sum = node.regrets.colwise().sum().row(action_dimension);
-	current_strategy = ArrayXX(node.regrets);
-	current_strategy /= Util::ExpandAs(regrets_sum, current_strategy); // We are dividing regrets for each actions by the sum of regrets for all actions and doing this element wise for every card
+	for (auto subtree_node = nodes.rbegin(); subtree_node != nodes.rend(); ++subtree_node)
+	{
+		_backward(*subtree_node, iter, scratch);
+	}
 
-	ArrayXX ranges_mul_matrix = node.ranges.row(currentPlayer).replicate(actions_count, 1);
-	children_ranges_absolute[currentPlayer] = current_strategy.array() * ranges_mul_matrix.array(); // Just multiplying ranges(cards probabilities) by the probability that action will be taken(from the strategy) inside the matrix  
-	children_ranges_absolute[opponentIndex] = node.ranges.row(opponentIndex).replicate(actions_count, 1); //For opponent we are just cloning ranges
+	tree.regrets().row(node) += tree.cf_values(player).row(node);
 }
 
-ArrayXX TreeCFR::ComputeRegrets(Node &node, ArrayXX &current_strategy, Array<float, Dynamic, card_count>* cf_values_allactions)
+const terminal_equity* TreeCFR::_get_terminal_equity(int node)
 {
-	Tensor<float, 2> tempVar;
-	static const int PLAYERS_DIM = 1;
-	const int actions_count = (int)node.children.size();
-	const int currentPlayer = node.current_player; // Because we have zero based indexes, unlike the original source.
-	const int opponent = 1 - node.current_player;
+	assert(_terminal_equities[node] != nullptr);
+	return _terminal_equities[node];
+}
 
-	assert(current_strategy.rows() == actions_count && current_strategy.cols() == card_count);
-	//current_strategy.conservativeResize(actions_count, card_count); // Do we need this?
+void TreeCFR::update_regrets(int node, const AmAxx& current_regrets)
+{
+	//--node.regrets:add(current_regrets)
+	//	--local negative_regrets = node.regrets[node.regrets:lt(0)]
+	//	--node.regrets[node.regrets:lt(0)] = negative_regrets
+	//--the floor is the regret-matching+ clipping, both modes keep the cumulative regrets positive
+	//--unless the pruning needs the negative ones
+	auto regrets = _tree->regrets().middleRows(_tree->first_child[node], _tree->children_count[node]);
+	regrets += current_regrets;
 
-	//Map<ArrayXX> opCfAr = Util::TensorToArray2d(cf_values_allactions, opponentIndexNorm, PLAYERS_DIM, tempVar);
+	if (!_pruning)
+	{
+		regrets = regrets.max(regret_epsilon);
+	}
+}
 
-	ArrayXX opCfAr = cf_values_allactions[opponent]; // [actions X cards] - cf values for the opponent
-	node.cf_values.row(opponent) = opCfAr.colwise().sum(); // for opponent assume that strategy is uniform
+void TreeCFR::update_average_strategy(int node, size_t iter, Scratch& scratch)
+{
+	if (iter >= _cfr_skip_iters)
+	{
+		FlatTree& tree = *_tree;
+		const int first = tree.first_child[node];
+		const int actions_count = tree.children_count[node];
 
-	//ArrayXX strategy_mul_matrix = current_strategy; //ToDo: remove or add copy
-	//Map<ArrayXX> plCfAr = Util::TensorToArray2d(cf_values_allactions, currentPlayerNorm, PLAYERS_DIM, tempVar);
+		auto strategy = tree.strategy().middleRows(first, actions_count);
+		auto current_strategy = tree.current_strategy().middleRows(first, actions_count);
+		auto iter_weight_sum = tree.reach_sum().row(node);
+		ArrayXX& iter_weight = scratch.iter_weight;
 
-	ArrayXX currentPlayerCfValues = cf_values_allactions[currentPlayer];
-	assert(currentPlayerCfValues.rows() == actions_count && currentPlayerCfValues.cols() == card_count);
+		iter_weight = tree.ranges(tree.current_player[node]).row(node).max(regret_epsilon);
 
-	ArrayXX weigtedCfValues = current_strategy * currentPlayerCfValues; // weight the regrets by the used strategy
-	node.cf_values.row(currentPlayer) = weigtedCfValues.colwise().sum(); // summing CF values for different actions
+		if (_mode == cfr_plus)
+		{
+			//--linear averaging: the iteration t after the delay is weighted by t
+			iter_weight *= (float)(iter - _cfr_skip_iters + 1);
+		}
+
+		iter_weight_sum += iter_weight;
+		iter_weight /= iter_weight_sum;
 
-	//--computing regrets
-	//Map<ArrayXX> current_regrets = Util::TensorToArray2d(cf_values_allactions, currentPlayerNorm, PLAYERS_DIM, tempVar);
+		for (int action = 0; action < actions_count; action++)
+		{
+			strategy.row(action) = strategy.row(action) * (1 - iter_weight) + current_strategy.row(action) * iter_weight;
+		}
+	}
+}
 
-	//current_regrets.resize(actions_count, card_count); Do we need this resize?
+void TreeCFR::_fillChanceRangesAndStrategy(int node)
+{
+	FlatTree& tree = *_tree;
+	const int first = tree.first_child[node];
+	const int actions_count = tree.children_count[node];
 
+	auto current_strategy = tree.current_strategy().middleRows(first, actions_count);
+	current_strategy = tree.strategy().middleRows(first, actions_count);
 
-	ArrayXX cfValuesOdCurrentPlayer = node.cf_values.row(currentPlayer);
-	cfValuesOdCurrentPlayer.resize(1, card_count); // [1(action) X card_count]
-	ArrayXX matrixToSubstract = cfValuesOdCurrentPlayer.replicate(actions_count, 1); // [actions X card_count]
-	currentPlayerCfValues -= matrixToSubstract; // Substructing sum of CF values over all actions with every action CF value
-	return currentPlayerCfValues;
+	for (int player = P1; player <= P2; player++)
+	{
+		tree.fill_chance_children(tree.ranges(player), tree.current_strategy(), node);
+	}
 }
 
+void TreeCFR::_fillPlayersRangesAndStrategy(int node, Scratch& scratch)
+{
+	FlatTree& tree = *_tree;
+	const int currentPlayer = tree.current_player[node];
+	const int opponentIndex = 1 - currentPlayer;
+	const int first = tree.first_child[node];
+	const int actions_count = tree.children_count[node];
+
+	//--we have to compute current strategy at the beginning of each iteration
+	auto regrets = tree.regrets().middleRows(first, actions_count);
+	assert((_pruning || (regrets >= regret_epsilon).all()) && "All regrets must be positive or uncomment commented code below.");
+
+	//--compute the current strategy
+	// We are dividing regrets for each actions by the sum of regrets for all actions and doing this element wise for every card
+	auto current_strategy = tree.current_strategy().middleRows(first, actions_count);
+
+	if (_pruning)
+	{
+		//--regret matching clips the negative regrets here instead, and the pruned actions are not played
+		current_strategy = regrets.max(regret_epsilon);
+
+		for (int action = 0; action < actions_count; action++)
+		{
+			if (_pruned_until[first + action] != 0)
+			{
+				current_strategy.row(action).setZero();
+			}
+		}
+	}
+	else
+	{
+		current_strategy = regrets;
+	}
 
+	//--the sums go through a buffer, a reduction inside the division would be evaluated into a temporary
+	scratch.regrets_sum = current_strategy.colwise().sum();
+	current_strategy.rowwise() /= scratch.regrets_sum.row(0);
 
+	AmAxx playerRanges = tree.ranges(currentPlayer);
+	AmAxx opponentRanges = tree.ranges(opponentIndex);
+	playerRanges.middleRows(first, actions_count) = current_strategy.rowwise() * playerRanges.row(node); // Just multiplying ranges(cards probabilities) by the probability that action will be taken(from the strategy) inside the matrix  
+	opponentRanges.middleRows(first, actions_count) = opponentRanges.row(node).replicate(actions_count, 1); //For opponent we are just cloning ranges
+}
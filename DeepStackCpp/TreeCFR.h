@@ -1,6 +1,10 @@
 #pragma once
 #include "Node.h"
+#include "FlatTree.h"
 #include "terminal_equity.h"
+#include "TerminalEquityRegistry.h"
+#include "ThreadPool.h"
+#include "tree_values.h"
 #include "assert.h"
 #include "Util.h"
 #include "arguments.h"
@@ -14,7 +18,10 @@ using namespace Eigen;
 class TreeCFR
 {
 public:
-	TreeCFR();
+	//-- - Constructor
+	//-- @param[opt] mode the regret minimization variant, one of @{constants.cfr_modes}
+	//--(default vanilla CFR)
+	TreeCFR(cfr_modes mode = cfr_vanilla);
 	~TreeCFR();
 
 	//	-- - Run CFR to solve the given game tree.
@@ -24,7 +31,49 @@ public:
 	//	-- @param[opt] iter_count the number of iterations to run CFR for
 	//	--(default @{arguments.cfr_iters
 	//})
-	void run_cfr(Node& root, const ArrayXX&  starting_ranges, size_t iter_count = cfr_iters, size_t skip_iters = cfr_skip_iters);
+	//	-- @param[opt] skip_iters the number of first iterations that are not factored
+	//	-- into the average strategy. In CFR+ mode this is the averaging delay.
+	//	-- @param[opt] threads_count the number of threads that solve the subtrees below
+	//	-- the chance nodes. The result does not depend on it.
+	void run_cfr(Node& root, const ArrayXX&  starting_ranges, size_t iter_count = cfr_iters, size_t skip_iters = cfr_skip_iters, int threads_count = cfr_threads);
+
+	//-- - Sets the exploitability at which @{run_cfr} stops before running all the iterations.
+	//--
+	//--The exploitability of the average strategy is computed with @{tree_values} every
+	//-- `check_iters` iterations after the skipped ones.
+	//-- @param target the exploitability target, zero runs all the iterations
+	//-- @param[opt] units the units of the target(default chips)
+	//-- @param[opt] check_iters the number of iterations between two checks
+	void set_target_exploitability(float target, exploitability_units units = cfr_exploitability_units, int check_iters = cfr_exploitability_check_iters);
+
+	//-- - Enables regret-based pruning, see @{arguments.cfr_regret_pruning}.
+	//--
+	//--Regret matching gives zero probability to an action whose regret is negative for every
+	//-- hand, and the regret can grow by at most twice the largest pot per iteration. The subtree
+	//-- of such an action is skipped for as many iterations as the regret surely stays negative.
+	//-- The opponent reaches the skipped subtree with the summed range of those iterations, and
+	//-- since the values are linear in it, a single pass over the subtree with the sum brings the
+	//-- regrets up to date when the action comes back. Requires vanilla mode, whose regrets are
+	//-- then no longer floored at zero.
+	//-- @param pruning whether to prune
+	//-- @param[opt] min_iters the shortest skip, see @{arguments.cfr_regret_pruning_min_iters}
+	void set_regret_pruning(bool pruning, int min_iters = cfr_regret_pruning_min_iters);
+
+	//-- - Makes @{run_cfr} assert that the iterations after the first one do not allocate.
+	//--
+	//--Only builds with EIGEN_RUNTIME_NO_MALLOC and asserts enabled check the Eigen allocations.
+	//-- The check is global to the process, so no other solver may run meanwhile.
+	//-- @param check whether to check
+	void set_allocation_check(bool check);
+
+	//-- - Gives the number of times an action was skipped by regret-based pruning in the last @{run_cfr}.
+	size_t get_pruned_actions() const;
+
+	//-- - Gives the number of iterations done by the last @{run_cfr}.
+	size_t get_iterations_done() const;
+
+	//-- - Gives the exploitability in chips measured by the last check, -1 if there was none.
+	float get_exploitability() const;
 
 private:
 
@@ -35,45 +84,170 @@ private:
 	// --for ease of implementation, we use small epsilon rather than zero when working with regrets
 	const float regret_epsilon = 1.0f / 1000000000;
 
-	map<ArrayX*, terminal_equity*> _cached_terminal_equities;
+	// Terminal equity evaluator of every terminal node, taken from @{TerminalEquityRegistry}
+	vector<const terminal_equity*> _terminal_equities;
 
 	size_t _cfr_skip_iters;
 
+	cfr_modes _mode;
+
+	// Early stopping, see @{set_target_exploitability}
+	float _target_exploitability = cfr_target_exploitability;
+	exploitability_units _target_units = cfr_exploitability_units;
+	int _exploitability_check_iters = cfr_exploitability_check_iters;
+
+	size_t _iterations_done = 0;
+
+	// See @{set_allocation_check}
+	bool _allocation_check = false;
+
+	float _exploitability = -1;
+
+	tree_values _tree_values;
+
+	// The player whose regrets and average strategy are updated in the current
+	// iteration. Both players are updated in vanilla mode.
+	int _updating_player;
+
+	// The tree being solved
+	FlatTree* _tree = nullptr;
+
+	// Workers that solve the subtrees below the chance nodes
+	ThreadPool* _pool = nullptr;
+
+	// Reach probabilities at or below this are treated as zero, see @{arguments.cfr_prune_reach}
+	float _prune_reach = cfr_prune_reach;
+
+	// Whether the node is skipped in the current iteration because neither player reaches it
+	// or the action that leads to it is pruned
+	vector<char> _skipped;
+
+	// Regret-based pruning, see @{set_regret_pruning}
+	bool _pruning = cfr_regret_pruning;
+	size_t _pruning_min_iters = cfr_regret_pruning_min_iters;
+
+	// The iteration at which the pruned action that leads to the node comes back, 0 if it is not pruned
+	vector<size_t> _pruned_until;
+
+	// The number of iterations of the current @{run_cfr}
+	size_t _iter_count = 0;
+
+	// The largest pot of the terminal nodes below every node
+	vector<float> _pot_bound;
+
+	// The largest sum of the range of every player at every node, reached when the players play every action
+	vector<float> _reach_bound[players_count];
+
+	// Nodes that are not below any chance node, in the tree order
+	vector<int> _trunk;
+
+	// Nodes of every subtree rooted at a child of a chance node of the trunk, in the tree order.
+	// Within an iteration the subtrees depend only on the trunk, not on each other.
+	vector<vector<int>> _subtrees;
+
+	// Buffers of a single worker thread
+	struct Scratch
+	{
+		// [players_count x card_count] buffers for the terminal equity evaluation
+		ArrayXX terminal_ranges = ArrayXX::Zero(players_count, card_count);
+		ArrayXX terminal_values = ArrayXX::Zero(players_count, card_count);
+
+		// [actions_count x card_count] buffer for the regrets of the current iteration, sized for the node with the most actions
+		ArrayXX current_regrets;
+
+		// [1 x card_count] buffers for the regret matching and the average strategy
+		ArrayXX regrets_sum = ArrayXX::Zero(1, card_count);
+		ArrayXX iter_weight = ArrayXX::Zero(1, card_count);
+
+		// Nodes of the subtree that is brought up to date after pruning, reserved for the largest subtree
+		vector<int> subtree;
+
+		// The number of actions skipped by the pruning
+		size_t pruned_actions = 0;
+	};
+
+	// Buffers indexed by the worker id of @{ThreadPool}
+	vector<Scratch> _scratch;
+
 	//-- - Gets an evaluator for player equities at a terminal node.
 	//--
-	//--Caches the result to minimize creation of @{terminal_equity | TerminalEquity
-	//}
-	//--objects.
-	//-- @param node the terminal node to evaluate
+	//--Evaluators are shared by all solvers through @{TerminalEquityRegistry}.
+	//-- @param node the index of the terminal node to evaluate
 	//-- @return a @{terminal_equity | TerminalEquity} evaluator for the node
-	terminal_equity* _get_terminal_equity(Node& node);
+	const terminal_equity* _get_terminal_equity(int node);
 
-	//-- - Recursively walks the tree, applying the CFR algorithm.
-	//	-- @param node the current node in the tree
+	//-- - Runs one CFR iteration as a forward sweep(strategies and ranges) followed by
+	//-- a backward sweep(values, regrets and the average strategy).
 	//	-- @param iter the current iteration number
 	//	-- @local
-	void cfrs_iter_dfs(Node& node, size_t iter);
+	void cfrs_iter(size_t iter);
 
-	void _fillCFvaluesForNonTerminalNode(Node &node, size_t iter);
+	//-- - Checks whether the average strategy is exploitable less than the target.
+	//-- @param iter the current iteration number
+	//-- @param starting_ranges the ranges at the root node
+	//-- @return true if CFR can stop
+	bool _target_reached(size_t iter, const ArrayXX& starting_ranges);
 
-	ArrayXX ComputeRegrets(Node &node, ArrayXX &current_strategy, Array<float, Dynamic, card_count>* cf_values_allactions);
+	//-- - Splits the tree into the trunk and the independent subtrees below its chance nodes.
+	void _split_tree();
 
-	void _fillChanceRangesAndStrategy(Node &node, map<int, ArrayXX> &children_ranges_absolute, ArrayXX& current_strategy);
+	//-- - Forward sweep step: fills the current strategy and the ranges of the children.
+	//--
+	//--The subtree of a node that neither player reaches is skipped. The values of both
+	//-- players are zero there and the regrets and the average strategy do not change, since
+	//-- the average is weighted by the own reach(in CFR+ the updating player's values come from
+	//-- the opponent's reach and the average from the own one, so both must be zero as well).
+	//-- @param node the node to fill the children of
+	//-- @param scratch buffers to use
+	void _forward(int node, Scratch& scratch);
+
+	//-- - Checks whether neither player reaches the node.
+	bool _zero_reach(int node);
+
+	//-- - Computes the bounds of the values at every node, which bound the change of a regret in one iteration.
+	void _compute_regret_bounds();
+
+	//-- - Starts pruning the actions of a node that cannot get a positive regret for a while.
+	//-- @param node the node whose regrets were just updated
+	//-- @param iter the current iteration number
+	void _prune_actions(int node, size_t iter);
+
+	//-- - Brings the pruned actions up to date.
+	//-- @param iter the last iteration that the actions were skipped in
+	//-- @param all whether to bring all the pruned actions back or only the ones whose time is up
+	void _catch_up_pruned(size_t iter, bool all);
 
-	void _fillPlayersRangesAndStrategy(Node & node, map<int, ArrayXX>& children_ranges_absolute, ArrayXX & current_strategy);
+	//-- - Runs one pass over the subtree of a pruned action with the opponent range summed
+	//-- over the skipped iterations and adds the resulting value to the regret of the action.
+	//-- @param node the node the action leads to
+	//-- @param iter the last iteration that the action was skipped in
+	//-- @param scratch buffers to use
+	void _catch_up(int node, size_t iter, Scratch& scratch);
+
+	//-- - Backward sweep step: fills the values and updates regrets and the average strategy.
+	void _backward(int node, size_t iter, Scratch& scratch);
+
+	void _fillCFvaluesForNonTerminalNode(int node, size_t iter, Scratch& scratch);
+
+	void _fillChanceRangesAndStrategy(int node);
+
+	void _fillPlayersRangesAndStrategy(int node, Scratch& scratch);
 
 	//-- - Update a node's total regrets with the current iteration regrets.
 	//-- @param node the node to update
 	//-- @param current_regrets the regrets from the current iteration of CFR
-	void update_regrets(Node& node, const ArrayXX& current_regrets);
+	void update_regrets(int node, const AmAxx& current_regrets);
 
 	//-- - Update a node's average strategy with the current iteration strategy.
+	//--
+	//-- Vanilla CFR weights the iterations after the skipped ones uniformly, CFR+
+	//-- weights them linearly by the iteration number.
 	//-- @param node the node to update
-	//-- @param current_strategy the CFR strategy for the current iteration
 	//-- @param iter the iteration number of the current CFR iteration
-	void update_average_strategy(Node& node, ArrayXX& current_strategy, size_t iter);
+	//-- @param scratch buffers to use
+	void update_average_strategy(int node, size_t iter, Scratch& scratch);
 
 	// Fill cf_values for terminal nodes
-	void _fillCFvaluesForTerminalNode(Node &node);
+	void _fillCFvaluesForTerminalNode(int node, Scratch& scratch);
 };
 
@@ -1,7 +1,9 @@
 #include "TreeLookahed.h"
+#include <algorithm>
+#include <limits>
 
 
-TreeLookahed::TreeLookahed(Node& root, long long skip_iters, long long iters)
+TreeLookahed::TreeLookahed(Node& root, long long skip_iters, long long iters, int batch_size) : _tree(root, batch_size)
 {
 	_cfr_skip_iters = skip_iters;
 	_cfr_iters = iters;
@@ -14,6 +16,24 @@ TreeLookahed::TreeLookahed(Node& root, long long skip_iters, long long iters)
 	{
 		_playersSwap = false;
 	}
+
+	_terminal_equities.assign(_tree.nodes_count, nullptr);
+	for (int node = 0; node < _tree.nodes_count; node++)
+	{
+		if (_tree.terminal[node])
+		{
+			_terminal_equities[node] = &TerminalEquityRegistry::instance().get(_tree.board(node));
+		}
+	}
+
+	_group_terminals();
+
+	//--the iterations only use the buffers sized here
+	const int max_actions_count = *max_element(_tree.children_count.begin(), _tree.children_count.end());
+	_current_regrets.resize(max_actions_count, _tree.columns_count);
+	_regrets_sum.resize(1, _tree.columns_count);
+	_iter_weight.resize(1, _tree.columns_count);
+	_subtree.reserve(_tree.nodes_count);
 }
 
 TreeLookahed::~TreeLookahed()
@@ -30,8 +50,22 @@ void TreeLookahed::resolve_first_node(const Range& player_range, const Range& op
 	_compute();
 }
 
+void TreeLookahed::resolve_first_node_batch(const Ranges& player_ranges, const Ranges& opponent_ranges)
+{
+	assert(player_ranges.rows() == _tree.batch_size && player_ranges.cols() == card_count);
+	assert(opponent_ranges.rows() == _tree.batch_size && opponent_ranges.cols() == card_count);
+	assert(_cfr_iters >= _cfr_skip_iters);
+
+	//--row major [batch_size x card_count] ranges have the same layout as a row of the tree
+	_root->ranges.resize(players_count, _tree.columns_count);
+	_root->ranges.row(P1) = Map<const ArrayXX>(player_ranges.data(), 1, _tree.columns_count);
+	_root->ranges.row(P2) = Map<const ArrayXX>(opponent_ranges.data(), 1, _tree.columns_count);
+	_compute();
+}
+
 void TreeLookahed::resolve(const Range& player_range, const Range& opponent_cfvs)
 {
+	assert(_tree.batch_size == 1 && "the gadget re-solves a single situation");
 	_root->ranges.row(P1) = player_range;
 	_reconstruction_gadget = new cfrd_gadget(_root->board, player_range, opponent_cfvs);
 	_reconstruction_opponent_cfvs = opponent_cfvs;
@@ -44,35 +78,40 @@ ArrayX TreeLookahed::get_chance_action_cfv(int action_index, ArrayX& board)
 	return ArrayX();
 }
 
-LookaheadResult TreeLookahed::get_results()
+LookaheadResult TreeLookahed::get_results(int situation)
 {
+	assert(situation >= 0 && situation < _tree.batch_size);
 	LookaheadResult out;
 	const int actionsCount = _root->children.size();
-	const int curPlayer = _getCurrentPlayer(*_root);
-	const int opPlayer = _getCurrentOpponent(*_root);
+	const int curPlayer = _getCurrentPlayer(0);
+	const int opPlayer = _getCurrentOpponent(0);
+
+	//--the columns of the situation
+	const int first = situation * card_count;
+	auto average_cfvs = _average_root_cfvs_data.middleCols(first, card_count);
 
 	//--1.0 average strategy
 	//--[actions x range]
 	//--lookahead already computes the average strategy we just convert the dimensions
-	out.strategy = _average_root_strategy;
+	out.strategy = _average_root_strategy.middleCols(first, card_count);
 
 	//--2.0 achieved opponent's CFVs at the starting node 
-	out.achieved_cfvs = _average_root_cfvs_data.row(opPlayer);
+	out.achieved_cfvs = average_cfvs.row(opPlayer);
 
 	//--3.0 CFVs for the acting player only when resolving first node
 	if (!_reconstruction)
 	{
-		out.root_cfvs = _average_root_cfvs_data.row(opPlayer);
+		out.root_cfvs = average_cfvs.row(opPlayer);
 
 		if (_playersSwap)
 		{
 			out.root_cfvs_both_players.resize(players_count, card_count);
-			out.root_cfvs_both_players.row(P1) = _average_root_cfvs_data.row(P2);
-			out.root_cfvs_both_players.row(P2) = _average_root_cfvs_data.row(P1);
+			out.root_cfvs_both_players.row(P1) = average_cfvs.row(P2);
+			out.root_cfvs_both_players.row(P2) = average_cfvs.row(P1);
 		}
 		else
 		{
-			out.root_cfvs_both_players = _average_root_cfvs_data;
+			out.root_cfvs_both_players = average_cfvs;
 		}
 	}
 
@@ -82,18 +121,18 @@ LookaheadResult TreeLookahed::get_results()
 
 	for (size_t childId = 0; childId < _root->children.size(); childId++)
 	{
-		out.children_cfvs.row(childId) = _average_root_child_cfvs_data[childId];
+		out.children_cfvs.row(childId) = _average_root_child_cfvs_data[childId].middleCols(first, card_count);
 	}
 
 	//--IMPORTANT divide average CFVs by average strategy in here
 	//scaler.replicate(actionsCount, 1);
 
-	auto range_mul = _root->ranges.row(P1).replicate(actionsCount, 1);
-	ArrayXX scaler = _average_root_strategy * range_mul;
+	auto range_mul = _root->ranges.row(P1).segment(first, card_count).replicate(actionsCount, 1);
+	ArrayXX scaler = out.strategy * range_mul;
 	auto scalerSum = scaler.rowwise().sum();
 	auto ss = scalerSum.replicate(1, card_count);
 	//scalerSum.replicate(actionsCount, 1);
-	scaler = ss * (_cfr_iters - _cfr_skip_iters);
+	scaler = ss * _average_weight_sum;
 	out.children_cfvs /= scaler;
 	assert(out.strategy.size() > 0);
 	assert(out.achieved_cfvs.size() > 0);
@@ -101,73 +140,384 @@ LookaheadResult TreeLookahed::get_results()
 	return out;
 }
 
-void TreeLookahed::_buildFlatList(Node& node)
+void TreeLookahed::_compute()
 {
-	const int actionsCount = node.children.size();
-	if (actionsCount > 0)
+	//--0.0 initialize regrets of the nodes that were not solved before
+	for (int node = 0; node < _tree.nodes_count; node++)
 	{
-		node.cf_values_allactions[P1].resize(actionsCount, card_count); // ToDo: move to the tree_builder
-		node.cf_values_allactions[P2].resize(actionsCount, card_count);
-
-		for (size_t i = 0; i < actionsCount; i++)
+		if (!_tree.terminal[node] && _tree.nodes[node]->regrets.size() == 0)
 		{
-			Node* curNode = node.children[i];
-			_nodes.push_back(curNode);
-			_buildFlatList(*curNode);
+			const int first = _tree.first_child[node];
+			auto regrets = _tree.regrets().middleRows(first, _tree.children_count[node]);
+			regrets.setConstant(regret_epsilon);
+			regrets.row(Fold) *= _tree.fold_mask[first + Fold];
 		}
 	}
-}
 
-void TreeLookahed::_compute()
-{
-	_nodes.push_back(_root);
-	_buildFlatList(*_root);
+	const int rootFirstChild = _tree.first_child[0];
+	const int rootActionsCount = _tree.children_count[0];
+	_skipped.assign(_tree.nodes_count, false);
+	_pruned_until.assign(_tree.nodes_count, 0);
+	_pruning_end = _cfr_iters;
+	_pruned_actions = 0;
+
+	if (_regret_pruning)
+	{
+		_compute_regret_bounds();
+	}
+
+	if (_average_root_strategy.size() == 0)
+	{
+		_average_root_strategy = ArrayXX::Zero(rootActionsCount, _tree.columns_count);
+		_average_root_cfvs_data = ArrayXX::Zero(players_count, _tree.columns_count);
+		_average_root_child_cfvs_data.assign(rootActionsCount, ArrayXX::Zero(1, _tree.columns_count));
+	}
 
 	//--1.0 main loop
 	for (size_t iter = 0; iter < _cfr_iters; iter++)
 	{
+		Util::SetMallocAllowed(!_allocation_check || iter == 0);
+
 		if (_reconstruction)
 		{
 			_set_opponent_starting_range();
 		}
 
-		for (size_t i = 0; i < _nodes.size(); i++) //Forward pass
+		_set_root_ranges();
+
+		if (iter > 0)
+		{
+			_catch_up_pruned(iter - 1, false);
+		}
+
+		_set_regrets_discounts(iter);
+
+		for (int node = 0; node < _tree.nodes_count; node++) //Forward pass
 		{
-			Node* curNode = _nodes[i];
-			cfrs_iter_dfs(*curNode, iter);
+			cfrs_iter_dfs(node, iter);
 		}
 
-		for (vector<Node*>::reverse_iterator curNodeIter = _nodes.rbegin(); 	curNodeIter != _nodes.rend(); ++curNodeIter) //Backward pass
+		_fillTerminalValues();
+
+		for (int node = _tree.nodes_count - 1; node >= 0; node--) //Backward pass
 		{
-			_back(*(*curNodeIter));
+			_back(node, iter);
 		}
 
 		if (iter >= _cfr_skip_iters)
 		{
 			//--no need to go through layers since we care for the average strategy only in the first node anyway
 			//--note that if you wanted to average strategy on lower layers, you would need to weight the current strategy by the current reach probability
-			_compute_update_average_strategies(_root->current_strategy);
-			_compute_cumulate_average_cfvs();
+			const float discount = _average_discount(iter);
+			_compute_update_average_strategies(AmAxx(_tree.current_strategy().row(rootFirstChild).data(), rootActionsCount, _tree.columns_count), discount);
+			_compute_cumulate_average_cfvs(discount);
+			_average_weight_sum = _average_weight_sum * discount + 1;
+
+			if (_target_exploitability > 0)
+			{
+				_update_average_tree_strategy();
+			}
+		}
+
+		_iterations_done = iter + 1;
+		Util::SetMallocAllowed(true);
+
+		if (_target_reached(iter))
+		{
+			break;
 		}
 	}
 
 
+	//--no action may get pruned again while the last ones are brought back
+	_pruning_end = _iterations_done;
+	_catch_up_pruned(_iterations_done - 1, true);
+
 	//--2.0 at the end normalize average strategy
 	_compute_normalize_average_strategies();
 	//--2.1 normalize root's CFVs
 	_compute_normalize_average_cfvs();
+
+	_tree.export_to_nodes();
+}
+
+void TreeLookahed::_update_average_tree_strategy()
+{
+	for (int node = 0; node < _tree.nodes_count; node++)
+	{
+		//--the own reach of a skipped node is zero, so it adds nothing
+		if (!_tree.terminal[node] && !_skipped[node])
+		{
+			_update_average_node_strategy(node);
+		}
+	}
+}
+
+void TreeLookahed::_update_average_node_strategy(int node)
+{
+	const int first = _tree.first_child[node];
+	const int actions_count = _tree.children_count[node];
+
+	auto strategy = _tree.strategy().middleRows(first, actions_count);
+	auto current_strategy = _tree.current_strategy().middleRows(first, actions_count);
+	auto iter_weight_sum = _tree.reach_sum().row(node);
+
+	_iter_weight = _tree.ranges(_getCurrentPlayer(node)).row(node).max(regret_epsilon);
+	iter_weight_sum += _iter_weight;
+	_iter_weight /= iter_weight_sum;
+
+	for (int action = 0; action < actions_count; action++)
+	{
+		strategy.row(action) = strategy.row(action) * (1 - _iter_weight) + current_strategy.row(action) * _iter_weight;
+	}
+}
+
+bool TreeLookahed::_target_reached(size_t iter)
+{
+	if (_target_exploitability <= 0 || iter < _cfr_skip_iters || (iter + 1 - _cfr_skip_iters) % _exploitability_check_iters != 0)
+	{
+		return false;
+	}
+
+	assert(_tree.batch_size == 1 && "the exploitability is computed for a single situation");
+
+	//--the skipped opponent strategies are averaged when their action comes back
+	_catch_up_pruned(iter, true);
+
+	//--the planes of the tree are in the order of the lookahead players, the evaluation uses the game players
+	ArrayXX starting_ranges(players_count, card_count);
+	starting_ranges.row(_playersSwap ? P2 : P1) = _root->ranges.row(P1);
+	starting_ranges.row(_playersSwap ? P1 : P2) = _root->ranges.row(P2);
+
+	//--the evaluation overwrites the values the gadget reads, so it works on a scratch tree
+	if (_evaluation == nullptr)
+	{
+		_evaluation.reset(new FlatTree(_tree));
+	}
+	else
+	{
+		_evaluation->strategy() = _tree.strategy();
+	}
+
+	_exploitability = _tree_values.compute_exploitability(*_evaluation, starting_ranges);
+	return tree_values::to_units(_exploitability, _target_units) < _target_exploitability;
+}
+
+void TreeLookahed::_set_regrets_discounts(size_t iter)
+{
+	if (_discounting)
+	{
+		_positive_regrets_discount = _regrets_discount(_discount_alpha, iter);
+		_negative_regrets_discount = _regrets_discount(_discount_beta, iter);
+	}
+}
+
+float TreeLookahed::_regrets_discount(float exponent, size_t iter)
+{
+	//--the regrets of the iteration t are discounted right after they are added
+	const float weight = pow((float)(iter + 1), exponent);
+	return weight / (weight + 1);
+}
+
+void TreeLookahed::_compute_regret_bounds()
+{
+	_pot_bound.assign(_tree.nodes_count, 0);
+
+	for (int node = _tree.nodes_count - 1; node >= 0; node--)
+	{
+		if (_tree.terminal[node])
+		{
+			_pot_bound[node] = _tree.pot[node];
+		}
+
+		if (_tree.parent[node] >= 0)
+		{
+			_pot_bound[_tree.parent[node]] = max(_pot_bound[_tree.parent[node]], _pot_bound[node]);
+		}
+	}
+
+	//--there are no chance nodes in the lookahead, the players reach every node with at most the root ranges.
+	//--The gadget range of the opponent is at most one for every hand.
+	for (int player = P1; player <= P2; player++)
+	{
+		_reach_bound[player] = 0;
+
+		for (int situation = 0; situation < _tree.batch_size; situation++)
+		{
+			_reach_bound[player] = max(_reach_bound[player], _root->ranges.row(player).segment(situation * card_count, card_count).sum());
+		}
+	}
+
+	if (_reconstruction)
+	{
+		_reach_bound[P2] = card_count;
+	}
+}
+
+void TreeLookahed::_prune_actions(int node, size_t iter)
+{
+	const int first = _tree.first_child[node];
+	const int actions_count = _tree.children_count[node];
+
+	if (iter + 1 >= _pruning_end)
+	{
+		return;
+	}
+
+	//--a value is at most the largest pot below times the opponent reach
+	const float reach_bound = _reach_bound[_getCurrentOpponent(node)];
+	int active = 0;
+
+	for (int child = first; child < first + actions_count; child++)
+	{
+		active += _pruned_until[child] == 0 && _tree.fold_mask[child] != 0;
+	}
+
+	for (int child = first; child < first + actions_count && active > 1; child++)
+	{
+		auto regrets = _tree.regrets().row(child);
+
+		//--a terminal action costs less than bringing it back. The hands blocked by the board keep their initial regrets.
+		if (_tree.terminal[child] || _pruned_until[child] != 0 || (regrets > regret_epsilon).any() || !(regrets < 0).any())
+		{
+			continue;
+		}
+
+		//--the regret grows by at most the largest value of the action minus the smallest value of the node per iteration,
+		//--and the discounts shrink it towards zero
+		const float bound = (_pot_bound[child] + _pot_bound[node]) * reach_bound;
+		float regret = -(regrets < 0).select(-regrets, numeric_limits<float>::max()).minCoeff();
+		size_t skip = 0;
+
+		while (iter + skip + 1 < _pruning_end && regret + bound <= 0)
+		{
+			skip++;
+			regret = (regret + bound) * (_discounting ? _regrets_discount(_discount_beta, iter + skip) : 1);
+		}
+
+		//--the pass that brings the action back averages all the skipped iterations or none
+		if (iter + 1 < _cfr_skip_iters)
+		{
+			skip = min(skip, _cfr_skip_iters - iter - 1);
+		}
+
+		if (skip >= _pruning_min_iters)
+		{
+			_pruned_until[child] = iter + skip + 1;
+			_tree.pruned_reach().row(child).setZero();
+			active--;
+		}
+	}
+}
+
+void TreeLookahed::_catch_up_pruned(size_t iter, bool all)
+{
+	if (!_regret_pruning)
+	{
+		return;
+	}
+
+	//--in the tree order, so an action pruned inside the subtree of another one gets its share of the other's pass first
+	for (int node = 0; node < _tree.nodes_count; node++)
+	{
+		if (_pruned_until[node] != 0 && (all || _pruned_until[node] <= iter + 1))
+		{
+			_catch_up(node, iter);
+		}
+	}
+}
+
+void TreeLookahed::_catch_up(int node, size_t iter)
+{
+	const int parent = _tree.parent[node];
+	const int player = _getCurrentPlayer(parent);
+	const int opponent = _getCurrentOpponent(parent);
+
+	_pruned_until[node] = 0;
+
+	//--the subtree in the tree order
+	_subtree.assign(1, node);
+
+	for (size_t i = 0; i < _subtree.size(); i++)
+	{
+		for (int child = 0; child < _tree.children_count[_subtree[i]]; child++)
+		{
+			_subtree.push_back(_tree.first_child[_subtree[i]] + child);
+		}
+	}
+
+	//--the player did not reach the action, his values only depend on the opponent range and the strategies,
+	//--which stayed the same while the subtree was skipped. The summed range is already discounted.
+	_tree.ranges(player).row(node).setZero();
+	_tree.ranges(opponent).row(node) = _tree.pruned_reach().row(node);
+	_skipped[parent] = false;
+
+	const float positive_discount = _positive_regrets_discount;
+	const float negative_discount = _negative_regrets_discount;
+	_positive_regrets_discount = 1;
+	_negative_regrets_discount = 1;
+
+	for (int subtree_node : _subtree)
+	{
+		cfrs_iter_dfs(subtree_node, iter);
+
+		//--the subtree is small, so its terminal nodes are evaluated one by one
+		if (_tree.terminal[subtree_node] && !_skipped[subtree_node])
+		{
+			_fillCFvaluesForTerminalNode(subtree_node);
+		}
+	}
+
+	for (auto subtree_node = _subtree.rbegin(); subtree_node != _subtree.rend(); ++subtree_node)
+	{
+		_back(*subtree_node, iter);
+	}
+
+	_positive_regrets_discount = positive_discount;
+	_negative_regrets_discount = negative_discount;
+
+	if (_target_exploitability > 0 && iter >= _cfr_skip_iters)
+	{
+		for (int subtree_node : _subtree)
+		{
+			if (!_tree.terminal[subtree_node] && !_skipped[subtree_node])
+			{
+				_update_average_node_strategy(subtree_node);
+			}
+		}
+	}
+
+	_tree.regrets().row(node) += _tree.cf_values(player).row(node);
+}
+
+float TreeLookahed::_average_discount(size_t iter)
+{
+	if (!_discounting || iter <= _cfr_skip_iters)
+	{
+		return 1;
+	}
+
+	//--the average of t iterations is discounted by (t / (t + 1))^gamma before adding the next one
+	const float t = (float)(iter - _cfr_skip_iters);
+	return pow(t / (t + 1), _discount_gamma);
+}
+
+void TreeLookahed::_set_root_ranges()
+{
+	_tree.ranges(P1).row(0) = _root->ranges.row(P1);
+	_tree.ranges(P2).row(0) = _root->ranges.row(P2);
 }
 
 void TreeLookahed::_set_opponent_starting_range()
 {
 	//int oponent = 1 - P1; // In the reconstruction CFR-D gadget we are adding opponent as the first node. So for this root we are just swapping players.
 	//_root->ranges.row(oponent) = _reconstruction_gadget->compute_opponent_range(_root->cf_values.row(oponent));
-	_root->ranges.row(P2) = _reconstruction_gadget->compute_opponent_range(_root->cf_values.row(P2));
+	_root->ranges.row(P2) = _reconstruction_gadget->compute_opponent_range(_tree.cf_values(P2).row(0));
 }
 
 void TreeLookahed::_compute_normalize_average_cfvs()
 {
-	_average_root_cfvs_data /= (_cfr_iters - _cfr_skip_iters);
+	_average_root_cfvs_data /= _average_weight_sum;
 }
 
 void TreeLookahed::_compute_terminal_equities_next_street_box()
@@ -175,17 +525,15 @@ void TreeLookahed::_compute_terminal_equities_next_street_box()
 	_average_root_strategy /= _average_root_strategy.rowwise().sum();
 }
 
-void TreeLookahed::_compute_update_average_strategies(ArrayXX& current_strategy)
+void TreeLookahed::_compute_update_average_strategies(const AmAxx& current_strategy, float discount)
 {
-	if (_average_root_strategy.size() == 0)
-	{
-		_average_root_strategy = current_strategy;
-	}
-	else
+	if (discount != 1)
 	{
-		_average_root_strategy += current_strategy;
+		_average_root_strategy *= discount;
 	}
 
+	_average_root_strategy += current_strategy;
+
 	//ToDo:
 	//--if the strategy is 'empty' (zero reach), strategy does not matter but we need to make sure
 	//--it sums to one->now we set to always fold
@@ -193,55 +541,52 @@ void TreeLookahed::_compute_update_average_strategies(ArrayXX& current_strategy)
 	//player_avg_strategy[player_avg_strategy:ne(player_avg_strategy)] = 0
 }
 
-int TreeLookahed::_getCurrentPlayer(const Node& node)
+int TreeLookahed::_getCurrentPlayer(int node)
 {
 	if (_playersSwap)
 	{
-		return 1 - node.current_player;
+		return 1 - _tree.current_player[node];
 	}
 	else
 	{
-		return node.current_player;
+		return _tree.current_player[node];
 	}
 }
 
-int TreeLookahed::_getCurrentOpponent(const Node& node)
+int TreeLookahed::_getCurrentOpponent(int node)
 {
 	if (_playersSwap)
 	{
-		return node.current_player;
+		return _tree.current_player[node];
 	}
 	else
 	{
-		return 1 - node.current_player;
+		return 1 - _tree.current_player[node];
 	}
 }
 
-void TreeLookahed::_compute_cumulate_average_cfvs()
+void TreeLookahed::_compute_cumulate_average_cfvs(float discount)
 {
-	if (_average_root_cfvs_data.size() == 0)
+	if (discount != 1)
 	{
-		_average_root_cfvs_data = _root->cf_values;
-	}
-	else
-	{
-		_average_root_cfvs_data += _root->cf_values;
-	}
+		_average_root_cfvs_data *= discount;
 
-	const int curOp = _getCurrentOpponent(*_root);
-	if (_average_root_child_cfvs_data.size() == 0)
-	{
-		for (size_t childId = 0; childId < _root->children.size(); childId++)
+		for (size_t childId = 0; childId < _average_root_child_cfvs_data.size(); childId++)
 		{
-			_average_root_child_cfvs_data.push_back(_root->children[childId]->cf_values.row(curOp));
+			_average_root_child_cfvs_data[childId] *= discount;
 		}
 	}
-	else
+
+	_average_root_cfvs_data.row(P1) += _tree.cf_values(P1).row(0);
+	_average_root_cfvs_data.row(P2) += _tree.cf_values(P2).row(0);
+
+	const int curOp = _getCurrentOpponent(0);
+	const int rootFirstChild = _tree.first_child[0];
+	AmAxx opponentCfValues = _tree.cf_values(curOp);
+
+	for (int childId = 0; childId < _tree.children_count[0]; childId++)
 	{
-		for (size_t childId = 0; childId < _root->children.size(); childId++)
-		{
-			_average_root_child_cfvs_data[childId] += _root->children[childId]->cf_values.row(curOp);
-		}
+		_average_root_child_cfvs_data[childId] += opponentCfValues.row(rootFirstChild + childId);
 	}
 }
 
@@ -262,193 +607,317 @@ void TreeLookahed::_compute_normalize_average_strategies()
 
 //------------------------------------------
 
-void TreeLookahed::cfrs_iter_dfs(Node& node, size_t iter)
+void TreeLookahed::cfrs_iter_dfs(int node, size_t iter)
 {
-	if (node.foldMask != 0 && node.parent != nullptr)
-	{
-		node.ranges.row(P1) = node.parent->children_ranges_absolute[P1].row(node.childId);
-		node.ranges.row(P2) = node.parent->children_ranges_absolute[P2].row(node.childId);
-	}
+	const int parent = _tree.parent[node];
+	_skipped[node] = (parent >= 0 && _skipped[parent]) || _pruned_until[node] != 0 || _zero_reach(node);
 
-	//--compute values using terminal_equity in terminal nodes
-	if (node.terminal)
+	if (_skipped[node])
 	{
-		_fillCFvaluesForTerminalNode(node);
+		//--only the root of a skipped subtree is read by its parent
+		if (parent < 0 || !_skipped[parent])
+		{
+			_tree.cf_values(P1).row(node).setZero();
+			_tree.cf_values(P2).row(node).setZero();
+		}
+
+		return;
 	}
-	else
+
+	//--ranges of the node are already filled by its parent
+	//--the terminal nodes are evaluated together once the ranges of all of them are known
+	if (!_tree.terminal[node])
 	{
 		_fillCFvaluesForNonTerminalNode(node, iter);
 	}
 }
 
-void TreeLookahed::_fillCFvaluesForTerminalNode(Node &node)
+void TreeLookahed::_fillCFvaluesForTerminalNode(int node)
 {
-	assert(node.terminal && (node.type == terminal_fold || node.type == terminal_call));
+	assert(_tree.terminal[node] && (_tree.type[node] == terminal_fold || _tree.type[node] == terminal_call));
 	int opponnent = _getCurrentOpponent(node);
 
-	terminal_equity* termEquity = _get_terminal_equity(node);
+	const terminal_equity* termEquity = _get_terminal_equity(node);
 
-	// CF values  2p X each private hand.
-	//node.cf_values.resize(players_count, card_count);
+	// CF values [batch x each private hand] of every player, the value of a player is the opponent range weighted by the equity
+	const AmAxx p1Ranges = _tree.situations(_tree.ranges(P1), node);
+	const AmAxx p2Ranges = _tree.situations(_tree.ranges(P2), node);
+	AmAxx p1Values = _tree.situations(_tree.cf_values(P1), node);
+	AmAxx p2Values = _tree.situations(_tree.cf_values(P2), node);
 
-	if (node.type == terminal_fold)
+	if (_tree.type[node] == terminal_fold)
 	{
-		if (node.foldMask == 0)
-		{
-			return;
-		}
-
-		termEquity->tree_node_fold_value(node.ranges, node.cf_values, opponnent);
+		termEquity->fold_value(p2Ranges, p1Values);
+		termEquity->fold_value(p1Ranges, p2Values);
 	}
 	else
 	{
-		termEquity->tree_node_call_value(node.ranges, node.cf_values);
+		termEquity->call_value(p2Ranges, p1Values);
+		termEquity->call_value(p1Ranges, p2Values);
 	}
 
-	//--multiply by the pot
-	node.cf_values *= node.pot;
+	//--multiply by the pot, the folding player loses it
+	_tree.cf_values(P1).row(node) *= _tree.pot[node];
+	_tree.cf_values(P2).row(node) *= _tree.pot[node];
 
-	//Looks like this not needed? ToDo: check during debugging!
-	//node.cf_values.conservativeResize(node.ranges_absolute.rows(), node.ranges_absolute.cols());
+	if (_tree.type[node] == terminal_fold)
+	{
+		_tree.cf_values(opponnent).row(node) *= -1;
+	}
 }
 
-
-void TreeLookahed::_fillCfvs(Node &node)
+void TreeLookahed::_group_terminals()
 {
-	const int actions_count = (int)node.children.size();
-	const int currentPlayer = _getCurrentPlayer(node);
-	const int opponent = _getCurrentOpponent(node);
+	size_t largest_group = 0;
 
-	//	assert(node.current_strategy.rows() == actions_count && node.current_strategy.cols() == card_count);
-	ArrayXX& opCfAr = node.cf_values_allactions[opponent]; // [actions X cards] - cf values for the opponent
-														   //opCfAr.row(Fold) *= node.children[Fold]->foldMask;
-	node.cf_values.row(opponent) = opCfAr.colwise().sum(); // for opponent assume that strategy is uniform
-
-														   //ArrayXX strategy_mul_matrix = current_strategy; //ToDo: remove or add copy
-														   //Map<ArrayXX> plCfAr = Util::TensorToArray2d(cf_values_allactions, currentPlayerNorm, PLAYERS_DIM, tempVar);
-
-	ArrayXX& playerCfValues = node.cf_values_allactions[currentPlayer];
-	//currentPlayerCfValues.row(Fold) *= node.children[Fold]->foldMask;
-	assert(playerCfValues.rows() == actions_count && playerCfValues.cols() == card_count);
+	for (int node = 0; node < _tree.nodes_count; node++)
+	{
+		if (!_tree.terminal[node])
+		{
+			continue;
+		}
 
-	auto weigtedCfValues = node.current_strategy * playerCfValues; // weight the regrets by the used strategy
-	node.cf_values.row(currentPlayer) = weigtedCfValues.colwise().sum(); // summing CF values for different actions
+		auto group = find_if(_terminal_groups.begin(), _terminal_groups.end(), [&](const TerminalGroup& terminal_group)
+		{
+			return terminal_group.equity == _terminal_equities[node] && terminal_group.type == _tree.type[node];
+		});
 
-																		 //--computing regrets
-																		 //Map<ArrayXX> current_regrets = Util::TensorToArray2d(cf_values_allactions, currentPlayerNorm, PLAYERS_DIM, tempVar);
+		if (group == _terminal_groups.end())
+		{
+			_terminal_groups.push_back({ _terminal_equities[node], _tree.type[node], {} });
+			group = _terminal_groups.end() - 1;
+		}
 
-																		 //current_regrets.resize(actions_count, card_count); Do we need this resize?
+		group->nodes.push_back(node);
+		largest_group = max(largest_group, group->nodes.size());
+	}
 
+	_active_terminals.reserve(largest_group);
+	_terminal_ranges.resize(players_count * _tree.batch_size * largest_group, card_count);
+	_terminal_values.resize(players_count * _tree.batch_size * largest_group, card_count);
 }
 
-void TreeLookahed::_back(Node &node)
+void TreeLookahed::_fillTerminalValues()
 {
-	if (!node.terminal)
-	{
-		_fillCfvs(node);
-		ArrayXX& current_regrets = ComputeRegrets(node);
-		update_regrets(node, current_regrets);
-	}
+	const int batch_size = _tree.batch_size;
 
-	//const int actionsCount = (int)node.children.size();
-	// Now coping cf_values from children to calculate the regret
-	if (node.parent != nullptr)
+	for (const TerminalGroup& group : _terminal_groups)
 	{
-		node.parent->cf_values_allactions[P1].row(node.childId) = node.cf_values.row(P1); //ToDo: Can be single copy operation(two rows copy)? ToDo:remove convention to Range
-		node.parent->cf_values_allactions[P2].row(node.childId) = node.cf_values.row(P2);
+		_active_terminals.clear();
+
+		for (int node : group.nodes)
+		{
+			if (!_skipped[node])
+			{
+				_active_terminals.push_back(node);
+			}
+		}
+
+		if (_active_terminals.empty())
+		{
+			continue;
+		}
+
+		//--gather: the ranges of the second player first, since they give the values of the first one
+		const int rows = players_count * batch_size * (int)_active_terminals.size();
+		AmAxx ranges(_terminal_ranges.data(), rows, card_count);
+		AmAxx values(_terminal_values.data(), rows, card_count);
+
+		for (size_t i = 0; i < _active_terminals.size(); i++)
+		{
+			const int node = _active_terminals[i];
+			ranges.middleRows((2 * i) * batch_size, batch_size) = _tree.situations(_tree.ranges(P2), node);
+			ranges.middleRows((2 * i + 1) * batch_size, batch_size) = _tree.situations(_tree.ranges(P1), node);
+		}
+
+		if (group.type == terminal_fold)
+		{
+			group.equity->fold_value(ranges, values);
+		}
+		else
+		{
+			group.equity->call_value(ranges, values);
+		}
+
+		//--scatter, multiplied by the pot, the folding player loses it
+		for (size_t i = 0; i < _active_terminals.size(); i++)
+		{
+			const int node = _active_terminals[i];
+			float p1_pot = _tree.pot[node];
+			float p2_pot = _tree.pot[node];
+
+			if (group.type == terminal_fold)
+			{
+				(_getCurrentOpponent(node) == P1 ? p1_pot : p2_pot) *= -1;
+			}
+
+			_tree.situations(_tree.cf_values(P1), node) = values.middleRows((2 * i) * batch_size, batch_size) * p1_pot;
+			_tree.situations(_tree.cf_values(P2), node) = values.middleRows((2 * i + 1) * batch_size, batch_size) * p2_pot;
+		}
 	}
 }
 
-void TreeLookahed::_fillCFvaluesForNonTerminalNode(Node &node, size_t iter)
+void TreeLookahed::_fillCfvs(int node)
 {
-	const int actions_count = (int)node.children.size();
-
-	static const int PLAYERS_DIM = 1;
+	const int first = _tree.first_child[node];
+	const int actions_count = _tree.children_count[node];
+	const int currentPlayer = _getCurrentPlayer(node);
+	const int opponent = _getCurrentOpponent(node);
 
-	_fillCurrentStrategy(node);
-	_fillChildRanges(node);
+	AmAxx opponentCfValues = _tree.cf_values(opponent);
+	opponentCfValues.row(node) = opponentCfValues.middleRows(first, actions_count).colwise().sum(); // for opponent assume that strategy is uniform
 
+	AmAxx playerCfValues = _tree.cf_values(currentPlayer);
+	auto weigtedCfValues = _tree.current_strategy().middleRows(first, actions_count) * playerCfValues.middleRows(first, actions_count); // weight the regrets by the used strategy
+	playerCfValues.row(node) = weigtedCfValues.colwise().sum(); // summing CF values for different actions
 }
 
-terminal_equity* TreeLookahed::_get_terminal_equity(Node& node)
+bool TreeLookahed::_zero_reach(int node)
 {
-	auto it = _cached_terminal_equities.find(&node.board);
-
-	terminal_equity* cached = nullptr;
-	if (it == _cached_terminal_equities.end())
+	//--the masked fold is never taken by the acting player and the opponent's values at it are not read
+	if (_tree.fold_mask[node] == 0)
 	{
-		cached = new terminal_equity();
-		cached->set_board(node.board);
-		_cached_terminal_equities[&node.board] = cached;
+		return true;
 	}
-	else
+
+	return (_tree.ranges(P1).row(node) <= _prune_reach).all() && (_tree.ranges(P2).row(node) <= _prune_reach).all();
+}
+
+void TreeLookahed::_back(int node, size_t iter)
+{
+	//--children cfvs are already in place, so the node only needs to aggregate them
+	if (!_tree.terminal[node] && !_skipped[node])
 	{
-		cached = it->second;
+		_fillCfvs(node);
+		const AmAxx current_regrets = ComputeRegrets(node);
+		update_regrets(node, current_regrets);
+
+		if (_regret_pruning)
+		{
+			//--a pruned action was charged the value of the node, the value of the action follows from the summed opponent range
+			const int first = _tree.first_child[node];
+			const int opponent = _getCurrentOpponent(node);
+
+			for (int child = first; child < first + _tree.children_count[node]; child++)
+			{
+				if (_pruned_until[child] != 0)
+				{
+					_tree.pruned_reach().row(child) = (_tree.pruned_reach().row(child) + _tree.ranges(opponent).row(node)) * _negative_regrets_discount;
+					_pruned_actions++;
+				}
+			}
+
+			_prune_actions(node, iter);
+		}
 	}
+}
 
-	return cached;
+void TreeLookahed::_fillCFvaluesForNonTerminalNode(int node, size_t iter)
+{
+	_fillCurrentStrategy(node);
+	_fillChildRanges(node);
+}
+
+const terminal_equity* TreeLookahed::_get_terminal_equity(int node)
+{
+	assert(_terminal_equities[node] != nullptr);
+	return _terminal_equities[node];
 }
 
-void TreeLookahed::update_regrets(Node& node, const ArrayXX& current_regrets)
+void TreeLookahed::update_regrets(int node, const AmAxx& current_regrets)
 {
 	//--node.regrets:add(current_regrets)
 	//	--local negative_regrets = node.regrets[node.regrets:lt(0)]
 	//	--node.regrets[node.regrets:lt(0)] = negative_regrets
-	node.regrets.array() += current_regrets;
+	const int first = _tree.first_child[node];
+	const int actions_count = _tree.children_count[node];
+	auto regrets = _tree.regrets().middleRows(first, actions_count);
+	regrets += current_regrets;
 
-	node.regrets = (node.regrets.array() >= regret_epsilon).select(
-		node.regrets,
-		ArrayXX::Constant(node.regrets.rows(), node.regrets.cols(), regret_epsilon));
+	if (_discounting)
+	{
+		//--DCFR keeps the negative regrets, the current strategy clips them instead.
+		//--The regret of a pruned action is negative, whatever the part that is not added yet.
+		for (int action = 0; action < actions_count; action++)
+		{
+			auto action_regrets = regrets.row(action);
+
+			if (_pruned_until[first + action] != 0)
+			{
+				action_regrets *= _negative_regrets_discount;
+			}
+			else
+			{
+				action_regrets = (action_regrets > 0).select(action_regrets * _positive_regrets_discount, action_regrets * _negative_regrets_discount);
+			}
+		}
+	}
+	else if (!_regret_pruning)
+	{
+		regrets = regrets.max(regret_epsilon);
+	}
 
-	node.regrets.row(Fold) *= node.children[Fold]->foldMask; // ToDo: possible we can remove this and avoid NANs when deviding by zero
+	regrets.row(Fold) *= _tree.fold_mask[first + Fold]; // ToDo: possible we can remove this and avoid NANs when deviding by zero
 }
 
 
-void TreeLookahed::_fillCurrentStrategy(Node & node)
+void TreeLookahed::_fillCurrentStrategy(int node)
 {
-	const int actions_count = (int)node.children.size();
+	const int first = _tree.first_child[node];
+	const int actions_count = _tree.children_count[node];
 
 	//--we have to compute current strategy at the beginning of each iteration
+	auto regrets = _tree.regrets().middleRows(first, actions_count);
+
+	//--compute the current strategy
+	// We are dividing regrets for each actions by the sum of regrets for all actions and doing this element wise for every card
+	auto current_strategy = _tree.current_strategy().middleRows(first, actions_count);
 
-	//--initialize regrets in the first iteration
-	if (node.regrets.size() == 0)
+	if (_discounting || _regret_pruning)
 	{
-		node.regrets = ArrayXX::Constant(actions_count, card_count, regret_epsilon);
-		node.regrets.row(Fold) *= node.children[Fold]->foldMask;
-	}
+		//--regret matching over the positive regrets, uniform over the legal actions if there are none
+		current_strategy = regrets.max(regret_epsilon);
+		current_strategy.row(Fold) *= _tree.fold_mask[first + Fold];
 
-	//	assert((node.regrets >= regret_epsilon).all() && "All regrets must be positive or uncomment commented code below.");
+		for (int action = 0; action < actions_count; action++)
+		{
+			if (_pruned_until[first + action] != 0)
+			{
+				current_strategy.row(action).setZero();
+			}
+		}
+	}
+	else
+	{
+		current_strategy = regrets;
+	}
 
-	//--compute the current strategy
-	node.regrets_sum = node.regrets.colwise().sum().row(action_dimension);
-	node.current_strategy = ArrayXX(node.regrets);
-	node.current_strategy /= Util::ExpandAs(node.regrets_sum, node.current_strategy); // We are dividing regrets for each actions by the sum of regrets for all actions and doing this element wise for every card
-																					  //current_strategy.row(Fold) *= node.children[Fold]->foldMask;
+	//--the sums go through a buffer, a reduction inside the division would be evaluated into a temporary
+	_regrets_sum = current_strategy.colwise().sum();
+	current_strategy.rowwise() /= _regrets_sum.row(0);
 }
 
-void TreeLookahed::_fillChildRanges(Node & node)
+void TreeLookahed::_fillChildRanges(int node)
 {
 	const int currentPlayer = _getCurrentPlayer(node); // Because we have zero based indexes, unlike the original source.
 	const int opponentIndex = _getCurrentOpponent(node);
-	const int actions_count = (int)node.children.size();
+	const int first = _tree.first_child[node];
+	const int actions_count = _tree.children_count[node];
 
-	auto ranges_mul_matrix = node.ranges.row(currentPlayer).replicate(actions_count, 1);
-	node.children_ranges_absolute[currentPlayer] = node.current_strategy.array() * ranges_mul_matrix.array(); // Just multiplying ranges(cards probabilities) by the probability that action will be taken(from the strategy) inside the matrix 
-	node.children_ranges_absolute[opponentIndex] = node.ranges.row(opponentIndex).replicate(actions_count, 1); //For opponent we are just cloning ranges
+	AmAxx playerRanges = _tree.ranges(currentPlayer);
+	AmAxx opponentRanges = _tree.ranges(opponentIndex);
+	playerRanges.middleRows(first, actions_count) = _tree.current_strategy().middleRows(first, actions_count).rowwise() * playerRanges.row(node); // Just multiplying ranges(cards probabilities) by the probability that action will be taken(from the strategy) inside the matrix 
+	opponentRanges.middleRows(first, actions_count) = opponentRanges.row(node).replicate(actions_count, 1); //For opponent we are just cloning ranges
 }
 
-CFVS TreeLookahed::ComputeRegrets(Node &node)
+AmAxx TreeLookahed::ComputeRegrets(int node)
 {
 	const int currentPlayer = _getCurrentPlayer(node);
-	const int opponent = _getCurrentOpponent(node);
-	const int actions_count = (int)node.children.size();
+	const int first = _tree.first_child[node];
+	const int actions_count = _tree.children_count[node];
 
-	auto cfValuesOdCurrentPlayer = node.cf_values.row(currentPlayer);
-	cfValuesOdCurrentPlayer.resize(1, card_count); // [1(action) X card_count]
-	auto matrixToSubstract = cfValuesOdCurrentPlayer.replicate(actions_count, 1); // [actions X card_count]
-	node.cf_values_allactions[currentPlayer] -= matrixToSubstract; // Substructing sum of CF values over all actions with every action CF value. Making regrets from CfValues.
-	return node.cf_values_allactions[currentPlayer];
+	AmAxx playerCfValues = _tree.cf_values(currentPlayer);
+	AmAxx current_regrets(_current_regrets.data(), actions_count, _tree.columns_count);
+	current_regrets = playerCfValues.middleRows(first, actions_count).rowwise() - playerCfValues.row(node); // Substructing sum of CF values over all actions with every action CF value. Making regrets from CfValues.
+	return current_regrets;
 }
-
-
-
@@ -1,12 +1,17 @@
 #pragma once
 #include <numeric>
+#include <cmath>
+#include <memory>
 #include "Node.h"
+#include "FlatTree.h"
 #include "assert.h"
 #include "arguments.h"
 #include "Util.h"
 #include "terminal_equity.h"
+#include "TerminalEquityRegistry.h"
 #include "cfrd_gadget.h"
 #include "LookaheadResult.h"
+#include "tree_values.h"
 
 class TreeLookahed
 {
@@ -22,7 +27,13 @@ public:
 	};
 
 
-	TreeLookahed(Node& root, long long skip_iters = cfr_skip_iters, long long iters = cfr_iters);
+	//-- - Constructor
+	//-- @param root the root of the lookahead tree
+	//-- @param[opt] skip_iters the number of iterations that are not factored into the averages
+	//-- @param[opt] iters the number of iterations
+	//-- @param[opt] batch_size the number of situations that share the tree and are solved together.
+	//-- The ranges of all the situations are stored side by side in the rows of the tree, see @{FlatTree}.
+	TreeLookahed(Node& root, long long skip_iters = cfr_skip_iters, long long iters = cfr_iters, int batch_size = 1);
 
 	~TreeLookahed();
 
@@ -34,12 +45,92 @@ public:
 
 	Node* _root;
 
+	// Flat copy of the lookahead tree that is traversed during re-solving
+	FlatTree _tree;
+
 	cfrd_gadget* _reconstruction_gadget;
 
 	Range _reconstruction_opponent_cfvs;
 
 	bool _reconstruction = false;
 
+	// Discounted CFR: regrets and averages of the earlier iterations are discounted every iteration
+	bool _discounting = cfr_discounting;
+
+	// Positive regrets are multiplied by t^alpha / (t^alpha + 1) after iteration t
+	float _discount_alpha = cfr_discount_alpha;
+
+	// Negative regrets are multiplied by t^beta / (t^beta + 1) after iteration t
+	float _discount_beta = cfr_discount_beta;
+
+	// The average strategy and cfvs are multiplied by (t / (t + 1))^gamma before adding iteration t + 1
+	float _discount_gamma = cfr_discount_gamma;
+
+	// Discount factors of the positive and negative regrets in the current iteration
+	float _positive_regrets_discount = 1;
+	float _negative_regrets_discount = 1;
+
+	// Sum of the (discounted) weights of the iterations accumulated into the averages
+	float _average_weight_sum = 0;
+
+	// Re-solving stops once the exploitability of the average strategy falls under the target, zero runs all the iterations.
+	// The average strategy of the whole lookahead is then tracked in the strategy plane of the tree(without discounting).
+	float _target_exploitability = cfr_target_exploitability;
+
+	// The units of @{_target_exploitability}
+	exploitability_units _target_units = cfr_exploitability_units;
+
+	// The number of iterations between two exploitability checks
+	int _exploitability_check_iters = cfr_exploitability_check_iters;
+
+	// The number of iterations done by the last re-solve
+	size_t _iterations_done = 0;
+
+	// The exploitability in chips measured by the last check, -1 if there was none
+	float _exploitability = -1;
+
+	tree_values _tree_values;
+
+	// Scratch copy of the tree that the exploitability checks evaluate, made by the first check.
+	// Only the strategy plane is copied into it afterwards, the evaluation fills the other planes.
+	unique_ptr<FlatTree> _evaluation;
+
+	// Reach probabilities at or below this are treated as zero, see @{arguments.cfr_prune_reach}
+	float _prune_reach = cfr_prune_reach;
+
+	// Whether the node is skipped in the current iteration because neither player reaches it in any situation
+	// or the action that leads to it is pruned
+	vector<char> _skipped;
+
+	// Regret-based pruning, see @{TreeCFR.set_regret_pruning}. Without discounting the regrets are
+	// then no longer floored at zero. With discounting the regrets inside a skipped subtree miss
+	// the discounts of the skipped iterations.
+	bool _regret_pruning = cfr_regret_pruning;
+
+	// The shortest skip, see @{arguments.cfr_regret_pruning_min_iters}
+	size_t _pruning_min_iters = cfr_regret_pruning_min_iters;
+
+	// The iteration at which the pruned action that leads to the node comes back, 0 if it is not pruned
+	vector<size_t> _pruned_until;
+
+	// No action is pruned past this iteration
+	size_t _pruning_end = 0;
+
+	// The largest pot of the terminal nodes below every node
+	vector<float> _pot_bound;
+
+	// The largest sum of the range of every player in a situation
+	float _reach_bound[players_count];
+
+	// Nodes of the subtree that is brought up to date after pruning, reserved for the whole tree
+	vector<int> _subtree;
+
+	// The number of times an action was skipped by the pruning in the last re-solve
+	size_t _pruned_actions = 0;
+
+	// Asserts that the iterations after the first one do not allocate, see @{TreeCFR.set_allocation_check}
+	bool _allocation_check = false;
+
 	//--dimensions in tensor
 	static const int action_dimension = 0;
 	static const int card_dimension = 1;
@@ -47,7 +138,25 @@ public:
 	// --for ease of implementation, we use small epsilon rather than zero when working with regrets
 	const float regret_epsilon = 1.0f / 1000000000;
 
-	map<ArrayX*, terminal_equity*> _cached_terminal_equities;
+	// Terminal equity evaluator of every terminal node, taken from @{TerminalEquityRegistry}
+	vector<const terminal_equity*> _terminal_equities;
+
+	// Terminal nodes of one type that share an evaluator, see @{_fillTerminalValues}
+	struct TerminalGroup
+	{
+		const terminal_equity* equity;
+		node_types type;
+		vector<int> nodes;
+	};
+
+	vector<TerminalGroup> _terminal_groups;
+
+	// The nodes of the group being evaluated that are not skipped in the current iteration, reserved for the largest group
+	vector<int> _active_terminals;
+
+	// [2 * batch_size * nodes x card_count] buffers for the ranges and the values of a group, sized for the largest group
+	ArrayXX _terminal_ranges;
+	ArrayXX _terminal_values;
 
 	// Contains sum of cfvs data for the root node that are accumulated after skip_iters iterations
 	Ranges _average_root_cfvs_data;
@@ -58,17 +167,22 @@ public:
 	// Average average strategy data
 	ArrayXX _average_root_strategy;
 
-	// Current strategy
-	ArrayXX _current_strategy;
+	// [actions_count x columns_count] buffer for the regrets of the current iteration, sized for the node with the most actions
+	ArrayXX _current_regrets;
+
+	// [1 x columns_count] buffers for the regret matching and the average strategy
+	ArrayXX _regrets_sum;
+	ArrayXX _iter_weight;
 
 	// Do wee need to swap players(if the first player to act in the lookahed is the second player)
 	bool _playersSwap;
 
-	vector <Node*> _nodes;
-
-	void _back(Node &node);
+	//-- - Backward pass step: fills the values of a node and updates its regrets.
+	//-- @param node the index of the node
+	//-- @param iter the current iteration number
+	void _back(int node, size_t iter);
 
-	void _fillCfvs(Node &node);
+	void _fillCfvs(int node);
 
 	//	--- Re - solves the lookahead using input ranges.
 	//	--
@@ -83,6 +197,12 @@ public:
 	//-- @param opponent_range a range vector for the opponent
 	void resolve_first_node(const Range& player_range, const  Range& opponent_range);
 
+	//	--- Re - solves a batch of situations that share the lookahead tree using input ranges.
+	//	--
+	//	-- @param player_ranges [batch_size x card_count] ranges of the re - solving player
+	//	-- @param opponent_ranges [batch_size x card_count] ranges of the opponent
+	void resolve_first_node_batch(const Ranges& player_ranges, const Ranges& opponent_ranges);
+
 	//-- - Re - solves the lookahead using an input range for the player and
 	//--the @{cfrd_gadget | CFRDGadget
 	//} to generate ranges for the opponent.
@@ -121,7 +241,9 @@ public:
 	//	--
 	//	-- * `children_cfvs`: an AxK tensor of opponent average counterfactual values after
 	//	-- each action that the re - solve player can take at the root of the lookahead
-	LookaheadResult get_results();
+	//	--
+	//	-- @param[opt] situation the index of the situation in the batch
+	LookaheadResult get_results(int situation = 0);
 
 	//-- - Re - solves the lookahead.
 	void _compute();
@@ -131,14 +253,15 @@ public:
 	void _compute_terminal_equities_next_street_box();
 
 	//-- - Updates the players' average strategies with their current strategies.
-	//-- @param iter the current iteration number of re - solving
-	void _compute_update_average_strategies(ArrayXX& current_strategy);
+	//-- @param current_strategy the current strategy at the root
+	//-- @param discount the factor applied to the accumulated strategy, see @{_average_discount}
+	void _compute_update_average_strategies(const AmAxx& current_strategy, float discount = 1);
 
 
 	//-- - Updates the players' average counterfactual values with their cfvs from the
 	//--current iteration.
-	//-- @param iter the current iteration number of re - solving
-	void _compute_cumulate_average_cfvs();
+	//-- @param discount the factor applied to the accumulated cfvs, see @{_average_discount}
+	void _compute_cumulate_average_cfvs(float discount = 1);
 
 	//-- - Normalizes the players' average strategies.
 	//	--
@@ -146,40 +269,85 @@ public:
 	//	-- strategies, which are simpler to compute.
 	void _compute_normalize_average_strategies();
 
-	int _getCurrentPlayer(const Node& node);
+	int _getCurrentPlayer(int node);
 
-	int _getCurrentOpponent(const Node& node);
+	int _getCurrentOpponent(int node);
 
 	//-- - Gets an evaluator for player equities at a terminal node.
 	//--
-	//--Caches the result to minimize creation of @{terminal_equity | TerminalEquity
-	//}
-	//--objects.
-	//-- @param node the terminal node to evaluate
+	//--Evaluators are shared by all solvers through @{TerminalEquityRegistry}.
+	//-- @param node the index of the terminal node to evaluate
 	//-- @return a @{terminal_equity | TerminalEquity} evaluator for the node
-	terminal_equity* _get_terminal_equity(Node& node);
+	const terminal_equity* _get_terminal_equity(int node);
 
-	//-- - Recursively walks the tree, applying the CFR algorithm.
-	//	-- @param node the current node in the tree
+	//-- - Forward pass step of the CFR algorithm for a single node.
+	//	-- @param node the index of the current node in the tree
 	//	-- @param iter the current iteration number
 	//	-- @local
-	void cfrs_iter_dfs(Node& node, size_t iter);
+	void cfrs_iter_dfs(int node, size_t iter);
 
-	void _fillCFvaluesForNonTerminalNode(Node &node, size_t iter);
+	void _fillCFvaluesForNonTerminalNode(int node, size_t iter);
 
-	CFVS ComputeRegrets(Node &node);
+	//-- - Checks whether neither player reaches the node. The subtree of such a node is
+	//-- skipped: the values are zero there and the regrets do not change. The masked
+	//-- fold is always skipped.
+	bool _zero_reach(int node);
 
-	void _fillChanceChildRanges(Node &node, Ranges(&children_ranges_absolute)[players_count]);
+	//-- - Computes the regrets of the current iteration from the children cfvs of the acting player.
+	//-- @return [actions_count x columns_count] regrets, valid until the next call
+	AmAxx ComputeRegrets(int node);
 
-	void _fillChildRanges(Node & node);
+	void _fillChildRanges(int node);
 
 	//-- - Update a node's total regrets with the current iteration regrets.
 	//-- @param node the node to update
 	//-- @param current_regrets the regrets from the current iteration of CFR
-	void update_regrets(Node& node, const ArrayXX& current_regrets);
+	void update_regrets(int node, const AmAxx& current_regrets);
+
+	//-- - Computes the regret discount factors of the iteration.
+	//-- @param iter the current iteration number
+	void _set_regrets_discounts(size_t iter);
+
+	//-- - Gives the DCFR factor of the regrets after an iteration.
+	//-- @param exponent the discount exponent of the regrets
+	//-- @param iter the iteration number
+	float _regrets_discount(float exponent, size_t iter);
+
+	//-- - Computes the bounds of the values at every node, which bound the change of a regret in one iteration.
+	void _compute_regret_bounds();
+
+	//-- - Starts pruning the actions of a node that cannot get a positive regret for a while.
+	//-- @param node the node whose regrets were just updated
+	//-- @param iter the current iteration number
+	void _prune_actions(int node, size_t iter);
+
+	//-- - Brings the pruned actions up to date.
+	//-- @param iter the last iteration that the actions were skipped in
+	//-- @param all whether to bring all the pruned actions back or only the ones whose time is up
+	void _catch_up_pruned(size_t iter, bool all);
+
+	//-- - Runs one pass over the subtree of a pruned action with the opponent range summed
+	//-- over the skipped iterations and adds the resulting value to the regret of the action.
+	//-- @param node the node the action leads to
+	//-- @param iter the last iteration that the action was skipped in
+	void _catch_up(int node, size_t iter);
+
+	//-- - Gives the factor by which the averages are discounted before accumulating the iteration.
+	//-- @param iter the current iteration number
+	//-- @return 1 unless discounting is enabled
+	float _average_discount(size_t iter);
 
 	// Fill cf_values for terminal nodes
-	void _fillCFvaluesForTerminalNode(Node &node);
+	void _fillCFvaluesForTerminalNode(int node);
+
+	//-- - Fills the values of all the terminal nodes that are not skipped in the current iteration.
+	//--
+	//--The ranges of the nodes of a @{TerminalGroup} are gathered into one matrix, so every group takes
+	//-- a single evaluation instead of a small one per node. The values are scattered back scaled by the pot.
+	void _fillTerminalValues();
+
+	//-- - Groups the terminal nodes by type and evaluator and sizes the buffers of @{_fillTerminalValues}.
+	void _group_terminals();
 
 	//-- - Generates the opponent's range for the current re-solve iteration using
 	//	--the @{cfrd_gadget | CFRDGadget}.
@@ -192,8 +360,22 @@ public:
 	//-- cfvs, which are simpler to compute.
 	void _compute_normalize_average_cfvs();
 
-	void _fillCurrentStrategy(Node & node);
+	void _fillCurrentStrategy(int node);
+
+	//-- - Copies the root ranges into the tree before the forward pass.
+	void _set_root_ranges();
+
+	//-- - Updates the average strategy of every node of the lookahead with the current
+	//-- strategy, weighted by the reach probability of the acting player.
+	void _update_average_tree_strategy();
+
+	//-- - Updates the average strategy of a node, see @{_update_average_tree_strategy}.
+	//-- @param node the index of a non terminal node
+	void _update_average_node_strategy(int node);
 
-	void _buildFlatList(Node& node);
+	//-- - Checks whether the average strategy is exploitable less than the target.
+	//-- @param iter the current iteration number
+	//-- @return true if re-solving can stop
+	bool _target_reached(size_t iter);
 };
 
@@ -173,7 +173,7 @@ GraphvizConnection* TreeVisualizer::nodes_to_graphviz_edge(const GraphvisNode& f
 	}
 
 	assert(child_id != -1);
-	out->Strategy = add_tensor(node.strategy.row(child_id), nullptr, "%.2f", &_card_to_string.card_to_string_table);
+	out->Strategy = add_tensor(node.strategy.row(child_id), nullptr, "%.2f", &GameContext::card_names());
 	edge_to_graphviz_counter++;
 	return out;
 }
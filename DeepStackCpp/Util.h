@@ -452,6 +452,15 @@ class Util
 			target = target.cwiseMax(lowLimin).cwiseMin(maxValue);
 		}
 
+		// Forbids or allows Eigen heap allocations. Only the builds with EIGEN_RUNTIME_NO_MALLOC
+		// check them, a forbidden allocation fails an Eigen assert.
+		static inline void SetMallocAllowed(bool allowed)
+		{
+#ifdef EIGEN_RUNTIME_NO_MALLOC
+			internal::set_is_malloc_allowed(allowed);
+#endif
+		}
+
 private:
 	struct greater
 	{
@@ -2,6 +2,7 @@
 #include <assert.h>
 #include <Eigen/Dense>
 #include <string>
+#include "Constants.h"
 
 // Parameters for DeepStack.
 //@module arguments
@@ -22,6 +23,8 @@ static const VectorX& bet_sizing = VectorX::Ones(1);
 //Tensor = torch.FloatTensor
 // the directory for data files
 static const string data_directory = "C:\\data\\";
+// the file of the precomputed terminal equities, see @{EquityStore}, written by `IntegrationTests equity_store [sorted]`. The equities are computed when it is missing
+static const string equity_store_path = data_directory + "equity.bin";
 // the size of the game"s ante, in chips
 static const long long ante = 100;
 // the size of each player"s stack, in chips
@@ -30,8 +33,40 @@ static const long long stack = 1200;
 static const int cfr_iters = 1000;
 // the number of preliminary CFR iterations which DeepStack doesn't factor into the average strategy (included in cfr_iters)
 static const int cfr_skip_iters = 500;
+// the number of threads that TreeCFR solves the subtrees below chance nodes with
+static const int cfr_threads = 1;
+// whether re-solving uses Discounted CFR, the skipped iterations should be set to zero then
+static const bool cfr_discounting = false;
+// DCFR discount exponent of the positive regrets
+static const float cfr_discount_alpha = 1.5f;
+// DCFR discount exponent of the negative regrets
+static const float cfr_discount_beta = 0.0f;
+// DCFR discount exponent of the average strategy and the average counterfactual values
+static const float cfr_discount_gamma = 2.0f;
+// CFR stops once the exploitability of the average strategy falls under this target, zero runs all the iterations
+static const float cfr_target_exploitability = 0;
+// the units of cfr_target_exploitability
+static const exploitability_units cfr_exploitability_units = exploitability_chips;
+// the number of iterations between two exploitability checks, the checks start after the skipped iterations
+static const int cfr_exploitability_check_iters = 100;
+// CFR skips the subtrees that both players reach with at most this probability for every hand
+static const float cfr_prune_reach = 0;
+// whether CFR skips the actions with a strongly negative regret for every hand for as long as they cannot become positive.
+// The vanilla modes then keep the negative regrets, CFR+ does not support it.
+static const bool cfr_regret_pruning = false;
+// the shortest skip of a pruned action, a shorter one does not pay for the pass that brings the action back
+static const int cfr_regret_pruning_min_iters = 2;
+// whether the showdown values of the last round are computed from the hands sorted by strength, in linear time
+// in the number of hands, instead of from the quadratic call matrix
+static const bool sorted_showdown = true;
+// whether re-solving uses the layer-wise lookahead engine instead of the per node one
+static const bool lookahead_layers = false;
 // how many poker situations are solved simultaneously during data generation
 static const int gen_batch_size = 10;
+// the number of threads that solve the poker situations during data generation
+static const int gen_threads = 1;
+// whether the generated data is also exported as NumPy .npy files for the trainer
+static const bool gen_export_npy = false;
 // how many poker situations are used in each neural net training batch
 static const int train_batch_size = 100;
 // path to the solved poker situation data used to train the neural net
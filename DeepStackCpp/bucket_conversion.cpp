@@ -17,19 +17,13 @@ void bucket_conversion::set_board(const ArrayX& board)
 	_range_matrix = ArrayXX::Zero(card_count, _bucket_count);
 
 	ArrayX buckets = _bucketer.compute_buckets(board);
-	ArrayXX class_ids = ArrayX::LinSpaced(1, 0, (float)_bucket_count).replicate(card_count, _bucket_count);
-	ArrayXX card_buckets = buckets.replicate(card_count, _bucket_count);
 
-	//--finding all strength classes
-	//--matrix for transformation from card ranges to strength class ranges
-	for (DenseIndex row = 0; row < class_ids.rows(); row++)
+	//--matrix for transformation from card ranges to bucket ranges, the impossible hands have no bucket
+	for (int card = 0; card < card_count; card++)
 	{
-		for (DenseIndex col = 0; col < class_ids.cols(); col++)
+		if (buckets(card) >= 0)
 		{
-			if (class_ids(row, col) == card_buckets(row, col))
-			{
-				_range_matrix == 1;
-			}
+			_range_matrix(card, (DenseIndex)buckets(card)) = 1;
 		}
 	}
 
@@ -42,12 +36,6 @@ void bucket_conversion::bucket_value_to_card_value(const ArrayX& bucket_value, A
 	card_value = bucket_value.matrix() * _reverse_value_matrix.matrix();
 }
 
-template <typename Derived, typename OtherDerived>
-void bucket_conversion::card_range_to_bucket_range(const ArrayBase<Derived>& card_range, ArrayBase<OtherDerived>& bucket_range)
-{
-	bucket_range = card_range.matrix() * _range_matrix.matrix();
-}
-
 ArrayXX bucket_conversion::get_possible_bucket_mask()
 {
 	ArrayXX mask = ArrayXX(1, _bucket_count);
@@ -34,7 +34,10 @@ public:
 	//-- @param bucket_range a vector in which to save the resulting probability
 	//-- vector over buckets
 	template<typename Derived, typename OtherDerived>
-	void card_range_to_bucket_range(const ArrayBase<Derived>& card_range, ArrayBase<OtherDerived>& bucket_range);
+	void card_range_to_bucket_range(const ArrayBase<Derived>& card_range, ArrayBase<OtherDerived>& bucket_range)
+	{
+		bucket_range = (card_range.matrix() * _range_matrix.matrix()).array();
+	}
 
 	//	-- - Gives a vector of possible buckets on the the board.
 	//	--
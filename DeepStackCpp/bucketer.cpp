@@ -18,12 +18,14 @@ size_t bucketer::get_bucket_count()
 
 ArrayX bucketer::compute_buckets(const ArrayX& board)
 {
-	size_t shift = (_cardTools.get_board_index(board) - 1) * card_count; // -1 ?
-	ArrayX buckets = ArrayX::LinSpaced(1, 0, card_count) + shift;
+	const CardSet board_cards(board);
+	const int shift = board_cards.board_index() * card_count;
+	ArrayX buckets(card_count);
+
 	//--impossible hands will have bucket number - 1
-	for (size_t i = 0; i < board.rows(); i++)
+	for (int card = 0; card < card_count; card++)
 	{
-		buckets[board[i]] = -1;
+		buckets(card) = board_cards.contains(card) ? -1.0f : (float)(shift + card);
 	}
 
 	return buckets;
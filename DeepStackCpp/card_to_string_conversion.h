@@ -6,29 +6,16 @@
 #include "CustomSettings.h"
 #include <Eigen/Dense>
 #include <string>
+#include "GameContext.h"
 
 using namespace std;
 
+// Conversions between the numeric and the string representations of the cards.
+// The tables are shared through @{GameContext}, so the object holds no state.
 class card_to_string_conversion
 {
-private:
-	// All possible card suits - only the first 2 are used in Leduc Hold'em.
-	static string const suit_table[];
-
-	// All possible card ranks - only the first 3 - 4 are used in Leduc Hold'em and 
-	//variants.
-	static string const  rank_table[];
-
 public:
 
-	// Holds the string representation for every possible card, indexed by its
-	// numeric representation.
-	unordered_map<int, string> card_to_string_table;
-
-	// Holds the numeric representation for every possible card, indexed by its
-	// string representation.
-	unordered_map<string, int> string_to_card_table;
-
 	card_to_string_conversion();
 
 	//-- Gets the rank of a card.
@@ -3,73 +3,120 @@
 #include <unordered_map>
 #include <stdlib.h>
 #include <time.h>
+#include <algorithm>
 
 card_tools::card_tools()
 {
-	_init_board_index_table();
 }
 
-bool card_tools::hand_is_possible(const ArrayX& hand) // Perfomance warning: Cant we change all ArrayX to vectors?
+bool card_tools::hand_is_possible(const ArrayX& hand)
 {
 	assert(hand.minCoeff() >= 0 && hand.maxCoeff() < card_count   && "Illegal cards in hand");
-	vector<bool> cards_table(card_count);
-
+	uint64_t cards_mask = 0;
 
 	for (int i = 0; i < hand.size(); i++)
 	{
-		int card = (int)hand(i);
-		if (cards_table[card]) // If this card already exists in hand
+		const uint64_t card = CardSet::bit((int)hand(i));
+		if (cards_mask & card) // If this card already exists in hand
 		{
 			return false;
 		}
 
-		cards_table[card] = true;
+		cards_mask |= card;
 	}
 
 	return true;
 }
 
-CardArray card_tools::get_possible_hand_indexes(const ArrayX& board)
+const card_tools::BoardTables& card_tools::_board_tables()
 {
-	CardArray out;
+	static const BoardTables tables = []()
+	{
+		BoardTables out;
+		const int slots_count = 1 + (board_card_count == 1 ? card_count : card_count * (card_count - 1) / 2);
+		out.possible_hands.resize(slots_count);
+		out.impossible_hands.resize(slots_count);
+		out.uniform_ranges.resize(slots_count);
+		out.hand_lists.resize(slots_count);
+		out.hand_columns.resize(slots_count);
 
-	out.setZero();
+		//--the empty board, then every board in the order of its index
+		vector<CardSet> boards(1);
+		for (int card_1 = 0; card_1 < card_count; card_1++)
+		{
+			if (board_card_count == 1)
+			{
+				boards.emplace_back();
+				boards.back().add(card_1);
+				continue;
+			}
 
-	if (board.size() == 0)
-	{
-		out.setOnes();
-		return out;
-	}
+			for (int card_2 = card_1 + 1; card_2 < card_count; card_2++)
+			{
+				boards.emplace_back();
+				boards.back().add(card_1);
+				boards.back().add(card_2);
+			}
+		}
 
-	int newSize = (int)board.size() + 1; //some extra space for one more element
-	ArrayX whole_hand(newSize);
-	
-	memcpy(whole_hand.data(), board.data(), board.size() * sizeof(float));  //copy data to the beginning
-	for (int card = 0; card < card_count; card++)
-	{
-		whole_hand[newSize - 1] = (float)card; // setting last element
-		if (hand_is_possible(whole_hand))
+		for (const CardSet& board : boards)
 		{
-			out(card) = 1;
+			const int slot = _board_slot(board);
+			for (int card = 0; card < card_count; card++)
+			{
+				out.possible_hands[slot](card) = board.contains(card) ? 0.0f : 1.0f;
+				out.hand_columns[slot][card] = board.contains(card) ? -1 : (int)out.hand_lists[slot].size();
+
+				if (!board.contains(card))
+				{
+					out.hand_lists[slot].push_back(card);
+				}
+			}
+
+			out.impossible_hands[slot] = 1 - out.possible_hands[slot];
+			out.uniform_ranges[slot] = out.possible_hands[slot] / out.possible_hands[slot].sum();
 		}
-	}
 
-	return out;
+		return out;
+	}();
+
+	return tables;
 }
 
-CardArray card_tools::get_impossible_hand_indexes(const ArrayX& board)
+int card_tools::_board_slot(const CardSet& board)
 {
-	CardArray out = get_possible_hand_indexes(board);
-	out -= 1;
-	out *= -1;
-	return out;
+	assert((board.empty() || board.size() == board_card_count) && "only the boards of the game have tables");
+	return board.empty() ? 0 : 1 + board.board_index();
 }
 
-CardArray card_tools::get_uniform_range(const ArrayX& board)
+const CardArray& card_tools::get_possible_hand_indexes(const ArrayX& board)
 {
-	CardArray out = get_possible_hand_indexes(board);
-	out /= out.sum();
-	return out;
+	return get_possible_hand_indexes(CardSet(board));
+}
+
+const CardArray& card_tools::get_possible_hand_indexes(const CardSet& board)
+{
+	return _board_tables().possible_hands[_board_slot(board)];
+}
+
+const vector<int>& card_tools::get_possible_hands(const CardSet& board)
+{
+	return _board_tables().hand_lists[_board_slot(board)];
+}
+
+const HandColumns& card_tools::get_hand_columns(const CardSet& board)
+{
+	return _board_tables().hand_columns[_board_slot(board)];
+}
+
+const CardArray& card_tools::get_impossible_hand_indexes(const ArrayX& board)
+{
+	return _board_tables().impossible_hands[_board_slot(CardSet(board))];
+}
+
+const CardArray& card_tools::get_uniform_range(const ArrayX& board)
+{
+	return _board_tables().uniform_ranges[_board_slot(CardSet(board))];
 }
 
 CardArray card_tools::get_random_range(const ArrayX& board, int seed = -1)
@@ -82,8 +129,7 @@ CardArray card_tools::get_random_range(const ArrayX& board, int seed = -1)
 	CardArray out;
 	out.Random();
 
-	CardArray possibleHands = get_possible_hand_indexes(board);
-	out *= possibleHands;
+	out *= get_possible_hand_indexes(board);
 	out /= out.sum();
 
 	return out;
@@ -109,7 +155,24 @@ long long card_tools::get_boards_count()
 	}
 	else
 	{
-		assert(false && "unsupported board size");
+		throw std::exception("unsupported board size");
+	}
+}
+
+long long card_tools::get_possible_boards_count()
+{
+	//--the boards of the cards that neither player holds
+	if (board_card_count == 1)
+	{
+		return card_count - 2;
+	}
+	else if (board_card_count == 2)
+	{
+		return ((long long)(card_count - 2) * (card_count - 3)) / 2;
+	}
+	else
+	{
+		throw std::exception("unsupported board size");
 	}
 }
 
@@ -134,9 +197,9 @@ ArrayXX card_tools::get_second_round_boards()
 		{
 			for (int card_2 = card_1 + 1; card_2 < card_count; card_2++)
 			{
-				board_idx++;
 				out(board_idx, 0) = (float)card_1;
 				out(board_idx, 1) = (float)card_2;
+				board_idx++;
 			}
 		}
 
@@ -145,63 +208,99 @@ ArrayXX card_tools::get_second_round_boards()
 	}
 	else
 	{
-		assert(false && "unsupported board size");
+		throw std::exception("unsupported board size");
 	}
 }
 
-auto ar = ArrayX::LinSpaced(5, 1, 5);
-
-void card_tools::_init_board_index_table()
+vector<CardPermutation> card_tools::get_suit_permutations()
 {
-	if (board_card_count == 1)
+	array<int, suit_count> suits;
+	for (int suit = 0; suit < suit_count; suit++)
 	{
-		_board_index_table = MatrixX(1, card_count);
-		_board_index_table.row(0) = ArrayX::LinSpaced(card_count, 0.0, (float)card_count - 1);
+		suits[suit] = suit;
 	}
-	else if (board_card_count == 2)
+
+	//--the suit of a card is card % suit_count, the rank is card / suit_count
+	vector<CardPermutation> out;
+	do
 	{
-		_board_index_table = ArrayXX::Constant(1, card_count, -1);
-		float board_idx = 0;
-		for (int card_1 = 0; card_1 < card_count; card_1++)
+		CardPermutation permutation;
+		for (int card = 0; card < card_count; card++)
 		{
-			for (int card_2 = card_1 + 1; card_2 < card_count; card_2++)
-			{
-				board_idx++;
-				_board_index_table(card_1, card_2) = board_idx;
-				_board_index_table(card_2, card_1) = board_idx;
-			}
+			permutation[card] = (card / suit_count) * suit_count + suits[card % suit_count];
 		}
-	}
-	else
+
+		out.push_back(permutation);
+	} while (next_permutation(suits.begin(), suits.end()));
+
+	return out;
+}
+
+ArrayX card_tools::permute_board(const ArrayX& board, const CardPermutation& permutation)
+{
+	ArrayX out(board.size());
+	for (int i = 0; i < board.size(); i++)
 	{
-		assert(false && "unsupported board size");
+		out(i) = (float)permutation[(int)board(i)];
 	}
+
+	sort(out.data(), out.data() + out.size());
+	return out;
 }
 
-int card_tools::get_board_index(const ArrayX& board)
+ArrayXX card_tools::get_canonical_second_round_boards(vector<vector<CardPermutation>>& board_permutations)
 {
-	int bordsSize = (int)board.size();
+	ArrayXX boards = get_second_round_boards();
+	vector<CardPermutation> permutations = get_suit_permutations();
+	vector<bool> covered(boards.rows(), false);
+	vector<int> canonical;
+	board_permutations.clear();
 
-	assert(bordsSize > 0 && bordsSize <= 2 && "unsupported board size");
-	if (bordsSize == 0)
-	{
-		return 0;
-	}
-	else if (bordsSize == 1)
+	for (int board = 0; board < boards.rows(); board++)
 	{
-		return (int)_board_index_table(0, (int)board(0));
+		if (covered[board])
+		{
+			continue;
+		}
+
+		//--the first board of a class is its representative, the images under the suit permutations are the class
+		canonical.push_back(board);
+		board_permutations.emplace_back();
+		ArrayX representative = boards.row(board);
+
+		for (const CardPermutation& permutation : permutations)
+		{
+			ArrayX image = permute_board(representative, permutation);
+
+			for (int other = board; other < boards.rows(); other++)
+			{
+				ArrayX candidate = boards.row(other);
+				if (!covered[other] && (candidate == image).all())
+				{
+					covered[other] = true;
+					board_permutations.back().push_back(permutation);
+				}
+			}
+		}
 	}
-	else
+
+	ArrayXX out(canonical.size(), boards.cols());
+	for (size_t i = 0; i < canonical.size(); i++)
 	{
-		return (int)_board_index_table((int)board(0), (int)board(1));
+		out.row(i) = boards.row(canonical[i]);
 	}
+
+	return out;
+}
+
+int card_tools::get_board_index(const ArrayX& board)
+{
+	return CardSet(board).board_index();
 }
 
 CardArray card_tools::normalize_range(const ArrayX& board, CardArray& range)
 {
-	ArrayX rangeM = ArrayX(range);
-	ArrayX mask = get_possible_hand_indexes(board);
-	CardArray out = rangeM * mask;
+	CardArray out = range * get_possible_hand_indexes(board);
 
 	auto sum = out.sum();
 
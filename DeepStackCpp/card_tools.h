@@ -2,8 +2,11 @@
 #include "game_settings.h"
 #include "CustomSettings.h"
 #include "constants.h"
+#include "CardSet.h"
 #include <Eigen/Dense>
 #include <memory>
+#include <vector>
+#include <array>
 
 using namespace std;
 
@@ -20,21 +23,38 @@ public:
 	// Gives the private hands which are valid with a given board.
 	// @param board a possibly empty vector of board cards
 	// @return a vector with an entry for every possible hand(private card), which
-	//  is `1` if the hand shares no cards with the board and `0` otherwise
-	CardArray get_possible_hand_indexes(const ArrayX& board);
+	//  is `1` if the hand shares no cards with the board and `0` otherwise.
+	//  The vectors of all the boards are computed once, see @{_board_tables}.
+	const CardArray& get_possible_hand_indexes(const ArrayX& board);
+
+	// Gives the private hands which are valid with a given board.
+	// @param board a possibly empty set of board cards
+	// @return the same vector as for the board given as a vector of cards
+	const CardArray& get_possible_hand_indexes(const CardSet& board);
+
+	// Gives the compact hand space of a board: the private hands that it does not block, in card order.
+	// The payloads of the board can keep only these columns, see @{FlatTree.compact}.
+	// @param board a possibly empty set of board cards
+	// @return the possible hands, every hand for the empty board
+	const vector<int>& get_possible_hands(const CardSet& board);
+
+	// Gives the column of every private hand in the compact hand space of a board.
+	// @param board a possibly empty set of board cards
+	// @return the index of every hand in @{get_possible_hands}, -1 for the hands that the board blocks
+	const HandColumns& get_hand_columns(const CardSet& board);
 
 	//  Gives the private hands which are invalid with a given board.
 	// @param board a possibly empty vector of board cards
 	// @return a vector with an entry for every possible hand(private card), which
 	// is `1` if the hand shares at least one card with the board and `0` otherwise
-	CardArray get_impossible_hand_indexes(const ArrayX& board);
+	const CardArray& get_impossible_hand_indexes(const ArrayX& board);
 
 	// Gives a range vector that has uniform probability on each hand which is
 	// valid with a given board.
 	// @param board a possibly empty vector of board cards
 	// @return a range vector where invalid hands have 0 probability and valid
 	// hands have uniform probability
-	CardArray get_uniform_range(const ArrayX& board);
+	const CardArray& get_uniform_range(const ArrayX& board);
 
 	// Randomly samples a range vector which is valid with a given board.
 	// @param board a possibly empty vector of board cards
@@ -52,9 +72,8 @@ public:
 	template <typename Derived>
 	bool is_valid_range(Eigen::ArrayBase<Derived> & range, ArrayX & board)
 	{
-		CardArray impossibleCards = get_impossible_hand_indexes(board);
-		CardArray check = range * impossibleCards;
-		bool only_possible_hands = check.sum() == 0;
+		const CardArray& impossibleCards = get_impossible_hand_indexes(board);
+		bool only_possible_hands = (range * impossibleCards).sum() == 0;
 		bool sums_to_one = abs(1.0 - range.sum()) < 0.0001;
 		return only_possible_hands && sums_to_one;
 	}
@@ -68,18 +87,35 @@ public:
 	// @return the number of possible boards
 	long long get_boards_count();
 
+	// Gives the number of boards that can be dealt once both players hold their private cards.
+	// @return the number of possible boards that share no card with a pair of distinct private cards
+	long long get_possible_boards_count();
+
 	// Gives all possible sets of board cards for the game.
 	// @return an NxK tensor, where N is the number of possible boards, and K is
 	// the number of cards on each board
 	ArrayXX get_second_round_boards();
 
-	// Initializes the board index table.
-	// @local
-	void _init_board_index_table();
+	// Gives all the permutations of the suits, as permutations of the cards.
+	// @return suit_count! permutations, the first one is the identity
+	vector<CardPermutation> get_suit_permutations();
+
+	// Gives one board of every class of suit-isomorphic second round boards.
+	// @param[out] board_permutations for every canonical board, the permutations that map it
+	// to each board of its class(the identity included), so the class size is its multiplicity
+	// @return an NxK tensor of the canonical boards, the first board of every class in the
+	// order of @{get_second_round_boards}
+	ArrayXX get_canonical_second_round_boards(vector<vector<CardPermutation>>& board_permutations);
+
+	// Applies a card permutation to a board.
+	// @param board a vector of board cards
+	// @param permutation a permutation from @{get_suit_permutations}
+	// @return the permuted board with the cards sorted
+	ArrayX permute_board(const ArrayX& board, const CardPermutation& permutation);
 
 	// Gives a numerical index for a set of board cards.
 	// @param board a non - empty vector of board cards
-	// @return the numerical index for the board
+	// @return the numerical index for the board, see @{CardSet.board_index}
 	int card_tools::get_board_index(const ArrayX& board);
 
 	// Normalizes a range vector over hands which are valid with a given board.
@@ -91,7 +127,20 @@ public:
 
 private:
 
-	// Id's of all possible boards
-	MatrixX _board_index_table;
+	// Masks, uniform ranges and compact hand spaces of the empty board and of every second round board
+	struct BoardTables
+	{
+		vector<CardArray, Eigen::aligned_allocator<CardArray>> possible_hands;
+		vector<CardArray, Eigen::aligned_allocator<CardArray>> impossible_hands;
+		vector<CardArray, Eigen::aligned_allocator<CardArray>> uniform_ranges;
+		vector<vector<int>> hand_lists;
+		vector<HandColumns> hand_columns;
+	};
+
+	// Gives the tables, built on the first call and shared by the process.
+	static const BoardTables& _board_tables();
+
+	// Gives the entry of a board in the tables, 0 for the empty board and 1 + @{CardSet.board_index} otherwise.
+	static int _board_slot(const CardSet& board);
 };
 
@@ -20,9 +20,9 @@ cfrd_gadget::cfrd_gadget(const ArrayX& board, const Range& player_range, const R
 	_range_mask = _card_tools.get_possible_hand_indexes(board);
 }
 
-Range cfrd_gadget::compute_opponent_range(const Range& current_opponent_cfvs)
+const CardArray& cfrd_gadget::compute_opponent_range(const CardArray& current_opponent_cfvs)
 {
-	CardArray play_values = current_opponent_cfvs;
+	const CardArray& play_values = current_opponent_cfvs;
 	CardArray& terminate_values = _input_opponent_value;
 
 	//--1.0 compute current regrets
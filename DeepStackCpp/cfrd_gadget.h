@@ -22,8 +22,8 @@ public:
 	//	-- @param current_opponent_cfvs the vector of cfvs that the opponent receives
 	//	-- with the current strategy in the re - solve game
 	//	-- @param iteration the current iteration number of re-solving
-	//	-- @return the opponent range vector for this iteration
-	Range compute_opponent_range(const Range& current_opponent_cfvs);
+	//	-- @return the opponent range vector for this iteration, valid until the next call
+	const CardArray& compute_opponent_range(const CardArray& current_opponent_cfvs);
 
 private:
 	const float regret_epsilon = 1.0f / 100000000;
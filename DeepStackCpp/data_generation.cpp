@@ -11,147 +11,238 @@ data_generation::~data_generation()
 {
 }
 
-void _print_time(std::chrono::duration<double> diff)
+void data_generation::_print_time(std::chrono::duration<double> diff)
 {
 	std::cout << duration_cast<std::chrono::hours>(diff).count() << " h "
 		<< duration_cast<std::chrono::minutes>(diff).count() << " m "
-		<< diff.count() << " s";
+		<< diff.count() << " s" << std::endl;
 }
 
 void data_generation::generate_data(size_t train_data_count, size_t valid_data_count)
 {
-	auto start = high_resolution_clock::now();
+	//-- every resolve below shares the terminal equities, so build them once upfront, from the precomputed file if there is one
+	TerminalEquityRegistry::instance().load(equity_store_path);
+	TerminalEquityRegistry::instance().build_all();
 
-	std::cout << "'Generating validation data ... ";
+	auto start = high_resolution_clock::now();
 
+	std::cout << "'Generating validation data ... " << std::endl;
+	generate_data_file(valid_data_count, data_path + "valid");
 
 	auto end = high_resolution_clock::now();
 	std::cout << "Validation gen time: ";
 	_print_time(end - start);
 
-	std::cout << "Generating data file... ";
+	std::cout << "Generating data file... " << std::endl;
+	start = high_resolution_clock::now();
+	generate_data_file(train_data_count, data_path + "train");
 
+	end = high_resolution_clock::now();
 	std::cout << "Generation data file time: ";
+	_print_time(end - start);
 }
 
-void _save_file(const char* filename, ArrayXX& dataArray)
+TrainingDataLayout data_generation::_layout()
 {
-	const int mode = ios::out | ios::binary | ios::trunc;
-	std::ofstream out(filename, mode);
-	typename ArrayXX::Index rows = dataArray.rows(), cols = dataArray.cols();
-	out.write((char*)(&rows), sizeof(typename ArrayXX::Index));
-	out.write((char*)(&cols), sizeof(typename ArrayXX::Index));
-	out.write((char*)dataArray.data(), rows*cols * sizeof(float));
-	out.close();
+	bucketer buck;
+	TrainingDataLayout layout;
+	layout.bucket_count = (int)buck.get_bucket_count();
+	layout.input_size = layout.bucket_count * players_count + 1;
+	layout.target_size = layout.bucket_count * players_count;
+	layout.mask_size = layout.bucket_count;
+	layout.chunk_rows = gen_batch_size;
+	return layout;
 }
 
-//void _read_file(const char* filename, ArrayXX& dataArray)
-//{
-//	std::ifstream in(filename, ios::in | std::ios::binary);
-//	typename ArrayXX::Index rows = 0, cols = 0;
-//	in.read((char*)(&rows), sizeof(typename ArrayXX::Index));
-//	in.read((char*)(&cols), sizeof(typename ArrayXX::Index));
-//	dataArray.resize(rows, cols);
-//	in.read((char *)dataArray.data(), rows*cols * sizeof(float));
-//	in.close();
-//}
-
-void data_generation::generate_data_file(size_t data_count, string file_name)
+void data_generation::generate_data_file(size_t data_count, string file_name, int workers_count)
 {
-		range_generator rng_generator;
-		bucket_conversion b_conversion;
-		random_card_generator card_generator;
-
-		size_t batch_size = gen_batch_size;
-		assert(data_count % batch_size == 0 && "data count has to be divisible by the batch size");
-		size_t batch_count = (size_t)(data_count / batch_size);
-		bucketer buck;
-		size_t bucket_count = buck.get_bucket_count();
-		size_t target_size = bucket_count * players_count;
-		ArrayXX  targets(data_count, target_size);
-		size_t input_size = bucket_count * players_count + 1;
-		ArrayXX inputs(data_count, input_size);
-		ArrayXX mask = ArrayXX::Zero(data_count, bucket_count);
-
-		//-- A mask of possible buckets
-		const ArrayXX bucket_mask = b_conversion.get_possible_bucket_mask();
-
-		for (size_t batch = 1; batch < batch_count; batch++)
-		{
-			ArrayX board = card_generator.generate_cards(board_card_count);
-			rng_generator.set_board(board);
-			b_conversion.set_board(board);
+	TrainingDataWriter writer;
+	if (!writer.open(file_name + ".data", _layout()))
+	{
+		std::cout << "Can not write the data file " << file_name << ".data" << std::endl;
+		return;
+	}
 
-			//--generating ranges players_count x batch_size x card_count
-			ArrayXX ranges[players_count];
+	const size_t committed_rows = writer.rows();
+	bool written = true;
 
-			for (int player = 1; player < players_count; player++)
-			{
-				rng_generator.generate_range(ranges[player]);
-			}
+	auto start = high_resolution_clock::now();
+	_generate(data_count, workers_count, [&writer, &written](const SolvedBatch& batch)
+	{
+		//--the batches solved after a failed write are dropped, the file keeps the committed ones
+		written = written && writer.append(batch.inputs, batch.targets, batch.mask);
+	});
+
+	std::chrono::duration<double> diff = high_resolution_clock::now() - start;
+	std::cout << data_count / diff.count() << " samples/s on " << workers_count << " workers" << std::endl;
+
+	if (!written)
+	{
+		std::cout << "Only " << writer.rows() - committed_rows << " examples were written to " << file_name << ".data" << std::endl;
+	}
+
+	writer.close();
+	TrainingDataReader reader;
+	if (gen_export_npy && !(reader.open(file_name + ".data") && reader.export_npy(file_name)))
+	{
+		std::cout << "Can not export " << file_name << ".data to NumPy files" << std::endl;
+	}
+}
 
-			//--generating pot sizes between ante and stack - 0.1
-			float min_pot = ante;
-			float max_pot = stack - 0.1;
-			float pot_range = max_pot - min_pot;
+void data_generation::generate(size_t data_count, int workers_count, ArrayXX& inputs, ArrayXX& targets, ArrayXX& mask)
+{
+	const TrainingDataLayout layout = _layout();
+	inputs.resize(data_count, layout.input_size);
+	targets.resize(data_count, layout.target_size);
+	mask.resize(data_count, layout.mask_size);
+
+	_generate(data_count, workers_count, [&inputs, &targets, &mask](const SolvedBatch& batch)
+	{
+		const size_t row = batch.batch * gen_batch_size;
+		inputs.middleRows(row, gen_batch_size) = batch.inputs;
+		targets.middleRows(row, gen_batch_size) = batch.targets;
+		mask.middleRows(row, gen_batch_size) = batch.mask;
+	});
+}
 
-			ArrayXX random_pot_sizes = ArrayXX::Random(gen_batch_size, 1) * pot_range + min_pot;
+void data_generation::_generate(size_t data_count, int workers_count, const function<void(const SolvedBatch&)>& sink)
+{
+	assert(workers_count > 0);
+	size_t batch_size = gen_batch_size;
+	assert(data_count % batch_size == 0 && "data count has to be divisible by the batch size");
+	size_t batch_count = (size_t)(data_count / batch_size);
+
+	//-- the workers only read the terminal equities, a no-op if they are already built
+	TerminalEquityRegistry::instance().build_all();
+
+	//-- a couple of batches per worker in flight keeps every stage busy without holding the whole data set
+	BlockingQueue<Sample> samples(2 * workers_count);
+	BlockingQueue<SolvedBatch> solved(2 * workers_count);
+
+	vector<thread> workers;
+	for (int worker = 0; worker < workers_count; worker++)
+	{
+		workers.emplace_back([this, &samples, &solved]()
+		{
+			Resolving resolving;
+			bucket_conversion b_conversion;
+			Sample sample;
 
-			//--pot features are pot sizes normalized between(ante / stack, 1)
-			ArrayXX pot_size_features = random_pot_sizes / stack;
+			while (samples.pop(sample))
+			{
+				SolvedBatch batch;
+				_solve(sample, resolving, b_conversion, batch);
+				solved.push(move(batch));
+			}
+		});
+	}
 
-			//--translating ranges to features
-			size_t batchStart = (batch - 1) * batch_size + 1;
-			size_t batchEnd = batch * batch_size;
-			size_t pot_feature_index = input_size;
+	thread writer([&solved, &sink]()
+	{
+		//-- the batches arrive in any order, the ones ahead of the next batch wait for it
+		map<size_t, SolvedBatch> pending;
+		size_t next_batch = 0;
+		SolvedBatch batch;
 
-			memcpy(inputs.data() + batchStart*pot_feature_index,
-				pot_size_features.data(),
-				pot_size_features.size() * sizeof(float));
+		while (solved.pop(batch))
+		{
+			pending.emplace(batch.batch, move(batch));
 
-			for (int playerId = 0; playerId < players_count; playerId++)
+			for (auto it = pending.find(next_batch); it != pending.end(); it = pending.find(++next_batch))
 			{
-				AmAxx imputsMap(inputs.data() + batchStart*playerId, bucket_count, playerId); //?
-				b_conversion.card_range_to_bucket_range(ranges[playerId], imputsMap);
+				sink(it->second);
+				pending.erase(it);
 			}
+		}
+	});
+
+	//-- the random generators are not thread safe, so the situations are sampled here, in the order of the batches
+	range_generator rng_generator;
+	random_card_generator card_generator;
+
+	for (size_t batch = 0; batch < batch_count; batch++)
+	{
+		Sample sample;
+		sample.batch = batch;
+		_sample(rng_generator, card_generator, sample);
+		samples.push(move(sample));
+	}
+
+	samples.close();
+	for (thread& worker : workers)
+	{
+		worker.join();
+	}
+
+	solved.close();
+	writer.join();
+}
 
-			//--computation of values using re - solving
-			// (players_count x batch_size x card_count)
-			ArrayXX values[players_count];
-			for (size_t i = 0; i < batch_size; i++)
-			{
-				Resolving resolving;
-				Node current_node;
-				current_node.board = board;
-				current_node.street = 2;
-				current_node.current_player = P1;
-				size_t pot_size = pot_size_features(i, 0) * stack;
-				current_node.bets(0) = pot_size;
-				current_node.bets(1) = pot_size;
-
-				ArrayX p1_range = ranges[P1].row(i);
-				ArrayX p2_range = ranges[P2].row(i);
-				resolving.resolve_first_node(current_node, p1_range, p2_range);
-				ArrayXX root_values = resolving.get_root_cfv_both_players();
-				root_values /= pot_size;
-
-				size_t target = players_count * i * card_count;
-
-				//Remove3D(values, i) = root_values;
-				for (int playerId = 0; playerId < players_count; playerId++)
-				{
-					//--translating values to nn targets
-					auto cardRange = values[playerId].row(card_count);
-					AmAx backetRange(targets.data(), card_count);
-					b_conversion.card_range_to_bucket_range(cardRange, backetRange);
-
-				}
-
-				mask.row(i) = bucket_mask.replicate(batch_size, bucket_count);
-			}
+void data_generation::_sample(range_generator& rng_generator, random_card_generator& card_generator, Sample& sample)
+{
+	sample.board = card_generator.generate_cards(board_card_count);
+	rng_generator.set_board(sample.board);
+
+	//--generating ranges players_count x batch_size x card_count
+	for (int player = P1; player < players_count; player++)
+	{
+		sample.ranges[player].resize(gen_batch_size, card_count);
+		rng_generator.generate_range(sample.ranges[player]);
+	}
+
+	//--generating pot sizes between ante and stack - 0.1
+	float min_pot = ante;
+	float max_pot = stack - 0.1f;
+	float pot_range = max_pot - min_pot;
+
+	//--the situations of a batch share the pot, so they share the lookahead tree and are solved together
+	sample.pot_size = (ArrayXX::Random(1, 1)(0, 0) + 1) / 2 * pot_range + min_pot;
+}
 
-			_save_file("C:\\data\\inputs.bin", inputs);
-			_save_file("C:\\data\\targets.bin", targets);
-			_save_file("C:\\data\\mask.bin", mask);
+void data_generation::_solve(const Sample& sample, Resolving& resolving, bucket_conversion& b_conversion, SolvedBatch& solved)
+{
+	const size_t batch_size = gen_batch_size;
+	bucketer buck;
+	const size_t bucket_count = buck.get_bucket_count();
+	b_conversion.set_board(sample.board);
+
+	solved.batch = sample.batch;
+	solved.inputs.resize(batch_size, bucket_count * players_count + 1);
+	solved.targets.resize(batch_size, bucket_count * players_count);
+
+	//-- A mask of possible buckets
+	solved.mask = b_conversion.get_possible_bucket_mask().replicate(batch_size, 1);
+
+	//--translating ranges to features
+	for (int playerId = 0; playerId < players_count; playerId++)
+	{
+		auto bucketRanges = solved.inputs.middleCols(playerId * bucket_count, bucket_count);
+		b_conversion.card_range_to_bucket_range(sample.ranges[playerId], bucketRanges);
+	}
+
+	//--pot features are pot sizes normalized between(ante / stack, 1)
+	solved.inputs.col(bucket_count * players_count).setConstant(sample.pot_size / stack);
+
+	//--computation of values using re - solving, the whole batch in one lookahead
+	Node current_node;
+	current_node.board = sample.board;
+	current_node.street = 2;
+	current_node.current_player = P1;
+	current_node.bets(0) = sample.pot_size;
+	current_node.bets(1) = sample.pot_size;
+
+	vector<LookaheadResult> results = resolving.resolve_first_node_batch(current_node, sample.ranges[P1], sample.ranges[P2]);
+
+	for (size_t i = 0; i < batch_size; i++)
+	{
+		//--translating values to nn targets
+		ArrayXX root_values = results[i].root_cfvs_both_players / sample.pot_size;
+
+		for (int playerId = 0; playerId < players_count; playerId++)
+		{
+			auto cardRange = root_values.row(playerId);
+			auto bucketRange = solved.targets.block(i, playerId * bucket_count, 1, bucket_count);
+			b_conversion.card_range_to_bucket_range(cardRange, bucketRange);
 		}
+	}
 }
@@ -6,11 +6,16 @@
 #include  "range_generator.h"
 #include "arguments.h"
 #include "Resolving.h"
+#include "TerminalEquityRegistry.h"
+#include "BlockingQueue.h"
+#include "TrainingData.h"
 #include <iostream>
 #include <chrono>
 #include <vector>
 #include <iostream>
-#include <fstream>
+#include <functional>
+#include <map>
+#include <thread>
 
 using namespace std;
 using std::chrono::duration_cast;
@@ -41,17 +46,70 @@ public:
 	//-- @{random_card_generator}.For description of neural net input and target
 	//-- type, see @{net_builder}.
 	//--
+	//--The examples are appended to a @{TrainingDataWriter} file as soon as they are solved, one
+	//-- chunk per batch, so an interrupted generation keeps the examples committed so far and
+	//-- a later call on the same file adds to them. With @{arguments.gen_export_npy} the whole
+	//-- file is then exported with @{TrainingDataReader.export_npy}.
 	//-- @param data_count the number of examples to generate
-	//-- @param file_name the prefix of the files where the data is saved(appended
-	//	-- with `.inputs`, `.targets`, and `.mask`).
-	void generate_data_file(size_t data_count, string file_name);
+	//-- @param file_name the prefix of the file where the data is saved(appended with `.data`)
+	//-- @param[opt] workers_count the number of threads that solve the situations(default @{arguments.gen_threads})
+	void generate_data_file(size_t data_count, string file_name, int workers_count = gen_threads);
+
+	//-- - Generates the examples of @{generate_data_file} in memory.
+	//--
+	//--The generation is a pipeline: the calling thread samples the batches of situations,
+	//-- the workers solve them, each with its own @{Resolving} that is reused for all its
+	//-- batches, and a writer thread takes the solved batches in order. The situations are
+	//-- sampled on a single thread in the order of the batches, so the examples depend on
+	//-- the random seed and not on the number of workers.
+	//-- @param data_count the number of examples to generate, a multiple of @{arguments.gen_batch_size}
+	//-- @param workers_count the number of threads that solve the situations
+	//-- @param[out] inputs [data_count x (2 x bucket_count + 1)] bucket ranges of both players and the pot feature
+	//-- @param[out] targets [data_count x (2 x bucket_count)] bucket values of both players, as fractions of the pot
+	//-- @param[out] mask [data_count x bucket_count] mask of the buckets that the board does not block
+	void generate(size_t data_count, int workers_count, ArrayXX& inputs, ArrayXX& targets, ArrayXX& mask);
 
 private:
 
-	void _print_time(std::chrono::duration<double> diff);
+	// A batch of situations that share the board and the pot
+	struct Sample
+	{
+		size_t batch;
+		ArrayX board;
+		float pot_size;
+		Ranges ranges[players_count];
+	};
+
+	// The examples of a solved batch
+	struct SolvedBatch
+	{
+		size_t batch;
+		ArrayXX inputs;
+		ArrayXX targets;
+		ArrayXX mask;
+	};
+
+	//-- - Runs the pipeline of @{generate}.
+	//-- @param data_count the number of examples to generate
+	//-- @param workers_count the number of threads that solve the situations
+	//-- @param sink called on the writer thread with every solved batch, in the order of the batches
+	void _generate(size_t data_count, int workers_count, const function<void(const SolvedBatch&)>& sink);
+
+	//-- - Gives the shapes of the examples, a chunk per batch.
+	TrainingDataLayout _layout();
+
+	//-- - Samples the board, the pot and the ranges of a batch.
+	//-- @param[out] sample the batch
+	void _sample(range_generator& rng_generator, random_card_generator& card_generator, Sample& sample);
 
-	// Saves data for training inside the binary file
-	void _save_file(const char* filename, ArrayXX& dataArray);
+	//-- - Solves a batch and converts it to examples.
+	//-- @param sample the batch
+	//-- @param resolving the resolver of the worker
+	//-- @param b_conversion the bucket conversion of the worker
+	//-- @param[out] solved the examples
+	void _solve(const Sample& sample, Resolving& resolving, bucket_conversion& b_conversion, SolvedBatch& solved);
+
+	void _print_time(std::chrono::duration<double> diff);
 
 };
 
@@ -2,6 +2,18 @@
 
 // Game constants which define the game played by DeepStack.
 // @module game_settings
+#ifdef EXTENDED_LEDUC
+//extended leduc definition: more ranks and a board of two cards, large enough to load-test the solver
+//defined by the ExtendedLeduc configuration, whose unit tests run without the ones tagged [leduc], which pin the cards of the original game
+// the number of card suits in the deck
+static const int suit_count = 2;
+// the number of card ranks in the deck
+static const int rank_count = 6;
+// the total number of cards in the deck
+static const int card_count = suit_count * rank_count;
+// the number of public cards dealt in the game(revealed after the first betting round)
+static const int board_card_count = 2;
+#else
 //leduc definition
 // the number of card suits in the deck
 static const int suit_count = 2;
@@ -11,5 +23,6 @@ static const int rank_count = 3;
 static const int card_count = suit_count * rank_count;
 // the number of public cards dealt in the game(revealed after the first betting round)
 static const int board_card_count = 1;
+#endif
 // the number of players in the game
-static const int player_count = 2;
\ No newline at end of file
+static const int player_count = 2;
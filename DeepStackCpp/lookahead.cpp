@@ -0,0 +1,381 @@
+#include "lookahead.h"
+
+
+lookahead::lookahead(Node& root, long long skip_iters, long long iters) : _tree(root)
+{
+	_cfr_skip_iters = skip_iters;
+	_cfr_iters = iters;
+	_root = &root;
+	_playersSwap = _root->current_player == P2;
+	_build_layers();
+}
+
+lookahead::~lookahead()
+{
+	if (_reconstruction_gadget != nullptr)
+	{
+		delete _reconstruction_gadget;
+		_reconstruction_gadget = nullptr;
+	}
+}
+
+void lookahead::_build_layers()
+{
+	_depth_count = (int)_tree.level_start.size() - 1;
+
+	_children_sum.resize(_depth_count);
+	_parent_copy.resize(_depth_count);
+	_acting_player.assign(_depth_count, -1);
+	_call_rows.resize(_depth_count);
+	_fold_rows.resize(_depth_count);
+	_call_coefficients.resize(_depth_count);
+	_fold_coefficients[P1].resize(_depth_count);
+	_fold_coefficients[P2].resize(_depth_count);
+	_regrets_mask.resize(_depth_count);
+
+	int board_node = -1;
+	size_t max_terminal_rows = 0;
+
+	for (int depth = 0; depth < _depth_count; depth++)
+	{
+		const int start = _tree.level_start[depth];
+		const int count = _tree.level_start[depth + 1] - start;
+
+		_regrets_mask[depth] = ArrayX::Ones(count);
+
+		vector<Triplet<float>> links;
+		vector<float> call_pots;
+		vector<float> fold_pots[players_count];
+
+		for (int row = 0; row < count; row++)
+		{
+			const int node = start + row;
+
+			if (depth > 0 && _tree.child_id[node] == 0)
+			{
+				_regrets_mask[depth](row) = _tree.fold_mask[node];
+			}
+
+			if (_tree.terminal[node])
+			{
+				assert(_tree.type[node] == terminal_fold || _tree.type[node] == terminal_call);
+				assert((board_node == -1 || _tree.board_index[board_node] == _tree.board_index[node]) && "the lookahead must be limited to one street");
+				board_node = node;
+
+				if (_tree.type[node] == terminal_call)
+				{
+					_call_rows[depth].push_back(row);
+					call_pots.push_back(_tree.pot[node]);
+				}
+				else if (_tree.fold_mask[node] != 0)
+				{
+					//--the folding player loses the pot
+					const int folding_player = _getCurrentOpponent(node);
+					_fold_rows[depth].push_back(row);
+					fold_pots[folding_player].push_back(-_tree.pot[node]);
+					fold_pots[1 - folding_player].push_back(_tree.pot[node]);
+				}
+
+				continue;
+			}
+
+			assert(_tree.current_player[node] != chance && "chance nodes are not supported by the lookahead");
+			assert((_acting_player[depth] == -1 || _acting_player[depth] == _getCurrentPlayer(node)) && "the player to act must be the same for the whole depth");
+			_acting_player[depth] = _getCurrentPlayer(node);
+
+			const int first = _tree.first_child[node] - _tree.level_start[depth + 1];
+			for (int child = 0; child < _tree.children_count[node]; child++)
+			{
+				links.emplace_back(row, first + child, 1.0f);
+			}
+		}
+
+		_call_coefficients[depth] = Map<ArrayX>(call_pots.data(), call_pots.size());
+		_fold_coefficients[P1][depth] = Map<ArrayX>(fold_pots[P1].data(), fold_pots[P1].size());
+		_fold_coefficients[P2][depth] = Map<ArrayX>(fold_pots[P2].data(), fold_pots[P2].size());
+		max_terminal_rows = max(max_terminal_rows, max(_call_rows[depth].size(), _fold_rows[depth].size()));
+
+		if (depth + 1 < _depth_count)
+		{
+			const int children = _tree.level_start[depth + 2] - _tree.level_start[depth + 1];
+			_children_sum[depth].resize(count, children);
+			_children_sum[depth].setFromTriplets(links.begin(), links.end());
+			_parent_copy[depth] = _children_sum[depth].transpose();
+		}
+	}
+
+	assert(board_node != -1 && "the lookahead has no terminal nodes");
+	_terminal_equity = &TerminalEquityRegistry::instance().get(_tree.board(board_node));
+	_call_matrix = _terminal_equity->get_call_matrix().matrix();
+
+	_terminal_ranges.resize(max_terminal_rows, card_count);
+	_terminal_values.resize(max_terminal_rows, card_count);
+}
+
+AmAxx lookahead::_layer(AmAxx plane, int depth)
+{
+	const int start = _tree.level_start[depth];
+	return AmAxx(plane.data() + (size_t)start * card_count, _tree.level_start[depth + 1] - start, card_count);
+}
+
+void lookahead::resolve_first_node(const Range& player_range, const Range& opponent_range)
+{
+	assert(player_range.size() > 0);
+	assert(opponent_range.size() > 0);
+	assert(_cfr_iters > _cfr_skip_iters && "the average needs at least one iteration after the skipped ones");
+	_root->ranges.row(P1) = player_range;
+	_root->ranges.row(P2) = opponent_range;
+	_compute();
+}
+
+void lookahead::resolve(const Range& player_range, const Range& opponent_cfvs)
+{
+	assert(_cfr_iters > _cfr_skip_iters && "the average needs at least one iteration after the skipped ones");
+	_root->ranges.row(P1) = player_range;
+	_reconstruction_gadget = new cfrd_gadget(_root->board, player_range, opponent_cfvs);
+	_reconstruction = true;
+	_compute();
+}
+
+void lookahead::_compute()
+{
+	//--0.0 initialize regrets
+	for (int depth = 1; depth < _depth_count; depth++)
+	{
+		AmAxx regrets = _layer(_tree.regrets(), depth);
+		regrets.setConstant(regret_epsilon);
+		regrets.colwise() *= _regrets_mask[depth];
+	}
+
+	//--1.0 main loop
+	for (size_t iter = 0; iter < _cfr_iters; iter++)
+	{
+		if (_reconstruction)
+		{
+			_set_opponent_starting_range();
+		}
+
+		_tree.ranges(P1).row(0) = _root->ranges.row(P1);
+		_tree.ranges(P2).row(0) = _root->ranges.row(P2);
+
+		for (int depth = 0; depth + 1 < _depth_count; depth++)
+		{
+			_compute_current_strategies(depth);
+			_compute_ranges(depth);
+		}
+
+		_compute_cfvs();
+		_compute_regrets();
+
+		if (iter >= _cfr_skip_iters)
+		{
+			_compute_update_average_strategies();
+			_compute_cumulate_average_cfvs();
+		}
+	}
+
+	//--2.0 at the end normalize average strategy
+	_compute_normalize_average_strategies();
+	//--2.1 normalize root's CFVs
+	_compute_normalize_average_cfvs();
+
+	_tree.export_to_nodes();
+}
+
+void lookahead::_compute_current_strategies(int depth)
+{
+	//--the regrets of the children of the depth are at the next one
+	AmAxx regrets = _layer(_tree.regrets(), depth + 1);
+	AmAxx current_strategy = _layer(_tree.current_strategy(), depth + 1);
+
+	//--regret matching: every regret divided by the sum of the regrets of its siblings
+	_parent_sums.noalias() = _children_sum[depth] * regrets.matrix();
+	current_strategy.matrix().noalias() = _parent_copy[depth] * _parent_sums;
+	current_strategy = regrets / current_strategy;
+}
+
+void lookahead::_compute_ranges(int depth)
+{
+	const int player = _acting_player[depth];
+	assert(player != -1);
+	const int opponent = 1 - player;
+
+	//--the opponent's range is copied to the children, the acting player's is multiplied by his strategy
+	_layer(_tree.ranges(opponent), depth + 1).matrix().noalias() = _parent_copy[depth] * _layer(_tree.ranges(opponent), depth).matrix();
+
+	AmAxx playerRanges = _layer(_tree.ranges(player), depth + 1);
+	playerRanges.matrix().noalias() = _parent_copy[depth] * _layer(_tree.ranges(player), depth).matrix();
+	playerRanges *= _layer(_tree.current_strategy(), depth + 1);
+}
+
+void lookahead::_compute_terminal_equities(int depth)
+{
+	for (int player = P1; player <= P2; player++)
+	{
+		AmAxx values = _layer(_tree.cf_values(player), depth);
+		AmAxx opponentRanges = _layer(_tree.ranges(1 - player), depth);
+
+		//--the non terminal rows only get the values of their children
+		values.setZero();
+
+		//--the value of a player is the opponent range weighted by the equity, times the pot
+		_compute_terminal_rows(values, opponentRanges, _call_rows[depth], terminal_call, _call_coefficients[depth]);
+		_compute_terminal_rows(values, opponentRanges, _fold_rows[depth], terminal_fold, _fold_coefficients[player][depth]);
+	}
+}
+
+void lookahead::_compute_terminal_rows(AmAxx values, AmAxx opponentRanges, const vector<int>& rows, node_types type, const ArrayX& coefficients)
+{
+	const int count = (int)rows.size();
+
+	if (count == 0)
+	{
+		return;
+	}
+
+	//--gather the ranges of the rows, so only they are evaluated
+	AmAxx ranges(_terminal_ranges.data(), count, card_count);
+	AmAxx terminalValues(_terminal_values.data(), count, card_count);
+
+	for (int i = 0; i < count; i++)
+	{
+		ranges.row(i) = opponentRanges.row(rows[i]);
+	}
+
+	if (type == terminal_call)
+	{
+		terminalValues.matrix().noalias() = ranges.matrix() * _call_matrix;
+	}
+	else
+	{
+		_terminal_equity->fold_value(ranges, terminalValues);
+	}
+
+	for (int i = 0; i < count; i++)
+	{
+		values.row(rows[i]) = terminalValues.row(i) * coefficients(i);
+	}
+}
+
+void lookahead::_compute_cfvs()
+{
+	for (int depth = _depth_count - 1; depth >= 0; depth--)
+	{
+		_compute_terminal_equities(depth);
+
+		if (depth + 1 == _depth_count)
+		{
+			continue;
+		}
+
+		const int player = _acting_player[depth];
+		const int opponent = 1 - player;
+
+		//--for opponent assume that strategy is uniform
+		_layer(_tree.cf_values(opponent), depth).matrix().noalias() += _children_sum[depth] * _layer(_tree.cf_values(opponent), depth + 1).matrix();
+
+		//--weight the children values of the acting player by the used strategy
+		_weighted_values = (_layer(_tree.current_strategy(), depth + 1) * _layer(_tree.cf_values(player), depth + 1)).matrix();
+		_layer(_tree.cf_values(player), depth).matrix().noalias() += _children_sum[depth] * _weighted_values;
+	}
+}
+
+void lookahead::_compute_regrets()
+{
+	for (int depth = 0; depth + 1 < _depth_count; depth++)
+	{
+		const int player = _acting_player[depth];
+		AmAxx regrets = _layer(_tree.regrets(), depth + 1);
+
+		//--value of every action minus the value of the node
+		_weighted_values.noalias() = _parent_copy[depth] * _layer(_tree.cf_values(player), depth).matrix();
+		regrets += _layer(_tree.cf_values(player), depth + 1) - _weighted_values.array();
+		regrets = regrets.max(regret_epsilon);
+		regrets.colwise() *= _regrets_mask[depth + 1];
+	}
+}
+
+void lookahead::_set_opponent_starting_range()
+{
+	_root->ranges.row(P2) = _reconstruction_gadget->compute_opponent_range(_tree.cf_values(P2).row(0));
+}
+
+void lookahead::_compute_update_average_strategies()
+{
+	//--the children of the root are the depth 1
+	AmAxx current_strategy = _layer(_tree.current_strategy(), 1);
+
+	if (_average_root_strategy.size() == 0)
+	{
+		_average_root_strategy = current_strategy;
+	}
+	else
+	{
+		_average_root_strategy += current_strategy;
+	}
+}
+
+void lookahead::_compute_cumulate_average_cfvs()
+{
+	const int opponent = _getCurrentOpponent(0);
+
+	if (_average_root_cfvs_data.size() == 0)
+	{
+		_average_root_cfvs_data = ArrayXX::Zero(players_count, card_count);
+		_average_root_child_cfvs_data = ArrayXX::Zero(_tree.children_count[0], card_count);
+	}
+
+	_average_root_cfvs_data.row(P1) += _tree.cf_values(P1).row(0);
+	_average_root_cfvs_data.row(P2) += _tree.cf_values(P2).row(0);
+	_average_root_child_cfvs_data += _layer(_tree.cf_values(opponent), 1);
+}
+
+void lookahead::_compute_normalize_average_strategies()
+{
+	_average_root_strategy.rowwise() /= _average_root_strategy.colwise().sum();
+}
+
+void lookahead::_compute_normalize_average_cfvs()
+{
+	_average_root_cfvs_data /= (_cfr_iters - _cfr_skip_iters);
+}
+
+LookaheadResult lookahead::get_results()
+{
+	LookaheadResult out;
+	const int actionsCount = _tree.children_count[0];
+	const int opPlayer = _getCurrentOpponent(0);
+
+	//--1.0 average strategy
+	out.strategy = _average_root_strategy;
+
+	//--2.0 achieved opponent's CFVs at the starting node
+	out.achieved_cfvs = _average_root_cfvs_data.row(opPlayer);
+
+	//--3.0 CFVs for the acting player only when resolving first node
+	if (!_reconstruction)
+	{
+		out.root_cfvs = _average_root_cfvs_data.row(opPlayer);
+		out.root_cfvs_both_players.resize(players_count, card_count);
+		out.root_cfvs_both_players.row(P1) = _average_root_cfvs_data.row(_playersSwap ? P2 : P1);
+		out.root_cfvs_both_players.row(P2) = _average_root_cfvs_data.row(_playersSwap ? P1 : P2);
+	}
+
+	//--4.0 children CFVs, divided by the average probability of the action
+	ArrayXX scaler = out.strategy.rowwise() * _root->ranges.row(P1);
+	ArrayX scalerSum = scaler.rowwise().sum() * (float)(_cfr_iters - _cfr_skip_iters);
+	out.children_cfvs = _average_root_child_cfvs_data.colwise() / scalerSum;
+
+	assert(out.strategy.rows() == actionsCount);
+	return out;
+}
+
+int lookahead::_getCurrentPlayer(int node)
+{
+	return _playersSwap ? 1 - _tree.current_player[node] : _tree.current_player[node];
+}
+
+int lookahead::_getCurrentOpponent(int node)
+{
+	return _playersSwap ? _tree.current_player[node] : 1 - _tree.current_player[node];
+}
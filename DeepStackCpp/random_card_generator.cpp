@@ -13,7 +13,7 @@ random_card_generator::~random_card_generator()
 ArrayX random_card_generator::generate_cards(size_t count)
 {
 	//--marking all used cards
-	size_t used_cards[card_count];
+	bool used_cards[card_count] = {};
 	ArrayX out = ArrayX(count);
 
 	//--counter for generated cards
@@ -22,11 +22,11 @@ ArrayX random_card_generator::generate_cards(size_t count)
 	{
 		int card = (int)(rand() % card_count);
 
-		if (used_cards[card] == 0)
+		if (!used_cards[card])
 		{
-			generated_cards_count++;
 			out(generated_cards_count) = (float)card;
-			used_cards[card] = 1;
+			generated_cards_count++;
+			used_cards[card] = true;
 		}
 	}
 
@@ -20,7 +20,7 @@ void strategy_filling::_fill_chance(Node& node)
 	//filling strategy
 	//we will fill strategy with an uniform probability, but it has to be zero for hands that are not possible on
 	//corresponding board
-	float cardsProbability = 1.0 / (card_count - 2); //remove 2 because each player holds one card
+	float cardsProbability = 1.0f / _card_tools.get_possible_boards_count(); //each player holds one card
 	node.strategy = ArrayXX(node.children.size(), card_count);
 	node.strategy.fill(cardsProbability);
 
@@ -40,7 +40,7 @@ void strategy_filling::_fill_chance(Node& node)
 	for (unsigned long long i = 0; i < node.children.size(); i++)
 	{
 		Node* child_node = node.children[i];
-		CardArray mask = _card_tools.get_possible_hand_indexes(child_node->board);
+		const CardArray& mask = _card_tools.get_possible_hand_indexes(child_node->board);
 		//node.strategy[i] : fill(0)
 		node.strategy.row(i) *= mask; // [i][mask] = 1.0 / (game_settings.card_count - 2)
 	}
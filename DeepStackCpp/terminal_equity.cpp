@@ -1,6 +1,8 @@
 #include "terminal_equity.h"
 #include <iostream>
 #include <string>
+#include <algorithm>
+#include <new>
 #include "Util.h"
 
 terminal_equity::terminal_equity() 
@@ -10,10 +12,27 @@ terminal_equity::terminal_equity()
 	set_board(board);
 }
 
+terminal_equity::terminal_equity(const ArrayX& board)
+{
+	_equity_matrix = ArrayXX(card_count, card_count);
+	set_board(board);
+}
+
+terminal_equity::terminal_equity(const ArrayX& board, const EquityStore::BoardData& data)
+{
+	_hands_count = data.hands_count;
+	_strength_order.assign(data.strength_order, data.strength_order + data.order_count);
+	_compact_strength_order.assign(data.compact_strength_order, data.compact_strength_order + data.order_count);
+	_strength_groups.assign(data.strength_groups, data.strength_groups + data.groups_count);
+	_view_call_matrices(data.call_matrix, data.compact_call_matrix);
+
+	_set_possible_hands(board);
+}
+
 void terminal_equity::set_board(const ArrayX & board)
 {
 	_set_call_matrix(board);
-	_set_fold_matrix(board);
+	_set_possible_hands(board);
 }
 
 
@@ -21,92 +40,198 @@ void terminal_equity::_set_call_matrix(const ArrayX & board)
 {
 	int street = _cardTools.board_to_street(board);
 	_equity_matrix.fill(0);
+	_strength_order.clear();
+	_compact_strength_order.clear();
+	_strength_groups.clear();
 
 	if (street == 1)
 	{
-		// --iterate through all possible next round streets
-		ArrayXX next_round_boards = _cardTools.get_second_round_boards();
-		size_t boards_count = next_round_boards.size();
-		ArrayXX next_round_equity_matrix = ArrayXX(card_count, card_count);
-		for (size_t board = 0; board < boards_count; board++)
+		// --iterate through the suit-isomorphic classes of the next round boards, the matrix of a board
+		// --of a class is the matrix of its representative with the hands permuted. The matrices are
+		// --added one board at a time, so none of them is built.
+		vector<vector<CardPermutation>> board_permutations;
+		ArrayXX next_round_boards = _cardTools.get_canonical_second_round_boards(board_permutations);
+		for (int board = 0; board < next_round_boards.rows(); board++)
 		{
-			ArrayX nextBoard = next_round_boards.row(board);
-			get_last_round_call_matrix(nextBoard, next_round_equity_matrix);
-			_equity_matrix += next_round_equity_matrix;
+			const CardSet next_board(next_round_boards.row(board));
+
+			for (const CardPermutation& permutation : board_permutations[board])
+			{
+				_add_last_round_call_matrix(next_board, permutation, _equity_matrix);
+			}
 		}
 
-		//--averaging the values in the call matrix
-		float weight_constant = board_card_count == 1 ? 1.0f / (card_count - 2) : 2.0f / ((card_count - 2) * (card_count - 3)); // Warning: Why '2' is in nominator for two cards board?
-		_equity_matrix *= weight_constant;
+		//--averaging the values in the call matrix over the boards that the private cards do not block
+		_equity_matrix /= (float)_cardTools.get_possible_boards_count();
 	}
 	else if (street == 2)
 	{
 		// --for last round we just return the matrix
 		get_last_round_call_matrix(board, _equity_matrix);
+		_set_strength_order(board);
 	}
 	else
 	{
 		//--impossible street
 		assert(false && "impossible street");
 	}
+
+	//--the compact matrix keeps the rows and the columns of the possible hands
+	const vector<int>& hands = _cardTools.get_possible_hands(CardSet(board));
+	_compact_equity_matrix.resize(hands.size(), hands.size());
+
+	for (size_t row = 0; row < hands.size(); row++)
+	{
+		for (size_t col = 0; col < hands.size(); col++)
+		{
+			_compact_equity_matrix(row, col) = _equity_matrix(hands[row], hands[col]);
+		}
+	}
+
+	_hands_count = (int)hands.size();
+	_view_call_matrices(_equity_matrix.data(), _compact_equity_matrix.data());
+}
+
+void terminal_equity::_view_call_matrices(const float* call_matrix, const float* compact_call_matrix)
+{
+	//--a map is bound to its memory when it is constructed
+	new (&_call_matrix) Map<const ArrayXX>(call_matrix, call_matrix ? card_count : 0, call_matrix ? card_count : 0);
+	new (&_compact_call_matrix) Map<const ArrayXX>(compact_call_matrix, compact_call_matrix ? _hands_count : 0, compact_call_matrix ? _hands_count : 0);
+}
+
+void terminal_equity::_set_strength_order(const ArrayX& board)
+{
+	//--the same strengths as the call matrix
+	const ArrayX strength = _evaluator.batch_eval(board);
+	const CardSet board_cards(board);
+
+	_strength_order.clear();
+	for (int hand = 0; hand < card_count; hand++)
+	{
+		if (!board_cards.contains(hand))
+		{
+			_strength_order.push_back(hand);
+		}
+	}
+
+	stable_sort(_strength_order.begin(), _strength_order.end(), [&strength](int first, int second) { return strength(first) < strength(second); });
+
+	_strength_groups.assign(1, 0);
+	for (int i = 1; i < (int)_strength_order.size(); i++)
+	{
+		if (strength(_strength_order[i]) != strength(_strength_order[i - 1]))
+		{
+			_strength_groups.push_back(i);
+		}
+	}
+
+	_strength_groups.push_back((int)_strength_order.size());
+
+	const HandColumns& columns = _cardTools.get_hand_columns(board_cards);
+	_compact_strength_order.clear();
+
+	for (int hand : _strength_order)
+	{
+		_compact_strength_order.push_back(columns[hand]);
+	}
 }
 
-void terminal_equity::_set_fold_matrix(const ArrayX & board)
+void terminal_equity::_set_possible_hands(const ArrayX & board)
 {
-	_fold_matrix.resize(card_count, card_count);
-	_fold_matrix.fill(1);
-	// --setting cards that block each other to zero - exactly elements on diagonal in leduc variants
-	_fold_matrix -= MatrixX::Identity(card_count, card_count).array();
-	_handle_blocking_cards(_fold_matrix, board);
+	_possible_hands = _cardTools.get_possible_hand_indexes(board).transpose();
 }
 
-void terminal_equity::tree_node_fold_value(const ArrayXX& ranges, ArrayXX& result, int folding_player)
+void terminal_equity::tree_node_fold_value(const ArrayXX& ranges, ArrayXX& result, int folding_player) const
 {
-	ArrayXX tempResult(result.rows(), result.cols());
-	fold_value(ranges, tempResult);
-	result.row(0) = tempResult.row(1);
-	result.row(1) = tempResult.row(0);
+	//--the values of a player come from the opponent range
+	fold_value(ranges, result);
+	result.row(0).swap(result.row(1));
 
 	result.row(folding_player) *= -1;
 }
 
-ArrayXX terminal_equity::get_call_matrix()
+ArrayXX terminal_equity::get_call_matrix() const
 {
-	return _equity_matrix;
+	if (_call_matrix.size() > 0)
+	{
+		return _call_matrix;
+	}
+
+	//--the sorted form: a hand wins against the groups of larger strength values and loses against the smaller ones
+	assert(!_strength_order.empty() && "only the last round boards have a sorted form");
+	ArrayXX out = ArrayXX::Zero(card_count, card_count);
+	const int groups_count = (int)_strength_groups.size() - 1;
+
+	for (int group = 0; group < groups_count; group++)
+	{
+		for (int other = group + 1; other < groups_count; other++)
+		{
+			for (int i = _strength_groups[group]; i < _strength_groups[group + 1]; i++)
+			{
+				for (int j = _strength_groups[other]; j < _strength_groups[other + 1]; j++)
+				{
+					out(_strength_order[j], _strength_order[i]) = 1;
+					out(_strength_order[i], _strength_order[j]) = -1;
+				}
+			}
+		}
+	}
+
+	return out;
 }
 
-void terminal_equity::tree_node_call_value(const ArrayXX& ranges, ArrayXX& result)
+void terminal_equity::tree_node_call_value(const ArrayXX& ranges, ArrayXX& result) const
 {
-	//ToDo: performance warning maybe just call_value and swap rows? Or Maps as below commented out will be faster?
-	ArrayXX tempResult(result.rows(), result.cols());
-	call_value(ranges, tempResult);
-	result.row(0) = tempResult.row(1);
-	result.row(1) = tempResult.row(0);
-	//result.row(0) = Map<ArrayXX>(tempResult.row(1).data(), 1, ranges.cols());
-	//result.row(1) = Map<ArrayXX>(tempResult.row(0).data(), 1, ranges.cols());
+	//--the values of a player come from the opponent range
+	call_value(ranges, result);
+	result.row(0).swap(result.row(1));
 }
 
-void terminal_equity::_handle_blocking_cards(ArrayXX& equity_matrix, const ArrayX& board)
+void terminal_equity::tree_node_compact_fold_value(const AmAxx& ranges, AmAxx& result, int folding_player) const
 {
-	RowVectorX possible_hand_indexes_1(_cardTools.get_possible_hand_indexes(board));
-	//ArrayXX possible_hand_matrix = possible_hand_indexes.replicate(card_count, 1); remove
-	equity_matrix *= possible_hand_indexes_1.replicate(card_count, 1).array();
+	compact_fold_value(ranges, result);
+	result.row(0).swap(result.row(1));
 
-	VectorX possible_hand_indexes_2(possible_hand_indexes_1);
-	equity_matrix *= possible_hand_indexes_2.replicate(1, card_count).array();
+	result.row(folding_player) *= -1;
+}
+
+void terminal_equity::tree_node_compact_call_value(const AmAxx& ranges, AmAxx& result) const
+{
+	compact_call_value(ranges, result);
+	result.row(0).swap(result.row(1));
+}
+
+void terminal_equity::_handle_blocking_cards(ArrayXX& equity_matrix, const ArrayX& board)
+{
+	const CardArray& possible_hand_indexes = _cardTools.get_possible_hand_indexes(board);
+	equity_matrix.rowwise() *= possible_hand_indexes.transpose();
+	equity_matrix.colwise() *= possible_hand_indexes;
 }
 
 void terminal_equity::get_last_round_call_matrix(const ArrayX& board_cards, ArrayXX& call_matrix)
 {
-	assert(board_cards.size() == 1 || board_cards.size() == 2 && "Only Leduc and extended Leduc are now supported.");
+	assert(board_cards.size() == board_card_count && "Only Leduc and extended Leduc are now supported.");
+
+	call_matrix = ArrayXX::Zero(card_count, card_count);
+	_add_last_round_call_matrix(CardSet(board_cards), _cardTools.get_suit_permutations().front(), call_matrix);
+}
 
-	VectorX strength = _evaluator.batch_eval(board_cards);
+void terminal_equity::_add_last_round_call_matrix(const CardSet& board, const CardPermutation& permutation, ArrayXX& call_matrix)
+{
+	//--the blocked hands are not in the list, so they keep a zero row and column
+	const vector<int>& hands = _cardTools.get_possible_hands(board);
+	CardArray strength;
 
-	VectorX v1(strength);
-	ArrayXX strength_view_1 = v1.replicate(1, card_count);
+	for (int hand : hands)
+	{
+		strength(hand) = LeducEvaluator::hand_strength(board, hand);
+	}
 
-	RowVectorX v2(strength);
-	ArrayXX strength_view_2 = v2.replicate(card_count, 1);
-	call_matrix = (strength_view_1 > strength_view_2).cast<float>() - (strength_view_1 < strength_view_2).cast<float>();
-	_handle_blocking_cards(call_matrix, board_cards);
+	for (int hand : hands)
+	{
+		for (int opponent_hand : hands)
+		{
+			call_matrix(permutation[hand], permutation[opponent_hand]) += (float)(strength(hand) > strength(opponent_hand)) - (float)(strength(hand) < strength(opponent_hand));
+		}
+	}
 }
@@ -3,8 +3,12 @@
 #include "assert.h"
 #include "LeducEvaluator.h"
 #include "game_settings.h"
+#include "arguments.h"
+#include "EquityStore.h"
 #include "assert.h"
 
+#include <vector>
+
 using namespace std;
 
 //-- - Evaluates player equities at terminal nodes of the game's public tree.
@@ -14,6 +18,23 @@ class terminal_equity
 public:
 	terminal_equity();
 
+	//-- - Creates the evaluator for the given board right away.
+	//-- @param board a possibly empty vector of board cards
+	explicit terminal_equity(const ArrayX& board);
+
+	//-- - Creates the evaluator for the given board from the data of an @{EquityStore}.
+	//--
+	//--The call matrices are read from the store, which must stay open as long as the evaluator
+	//-- is used. A board stored in the sorted form has no call matrices, so it is only evaluated
+	//-- with @{arguments.sorted_showdown} set.
+	//-- @param board a possibly empty vector of board cards
+	//-- @param data the stored data of the board
+	terminal_equity(const ArrayX& board, const EquityStore::BoardData& data);
+
+	// The kernels may read the matrices of the evaluator itself, so it is never copied
+	terminal_equity(const terminal_equity&) = delete;
+	terminal_equity& operator=(const terminal_equity&) = delete;
+
 	//-- - Zeroes entries in an equity matrix that correspond to invalid hands.
 	//--
 	//--A hand is invalid if it shares any cards with the board.
@@ -31,6 +52,15 @@ public:
 	//	-- @param call_matrix a tensor where the computed matrix is stored
 	void get_last_round_call_matrix(const ArrayX& board_cards, ArrayXX& call_matrix);
 
+	//-- - Adds the call matrix of a last round board, with the hands permuted, to a matrix.
+	//--
+	//--The strengths are looked up in @{leduc_strengths.table}, so the first round matrix sums the
+	//-- boards one at a time without building their matrices.
+	//-- @param board a last round board
+	//-- @param permutation the image of every hand, see @{card_tools.get_suit_permutations}
+	//-- @param call_matrix the [card_count x card_count] matrix to add to
+	void _add_last_round_call_matrix(const CardSet& board, const CardPermutation& permutation, ArrayXX& call_matrix);
+
 	//-- - Sets the board cards for the evaluator and creates its internal data structures.
 	//-- @param board a possibly empty vector of board cards
 	void set_board(const ArrayX& board);
@@ -45,25 +75,145 @@ public:
 	//-- @param board a possibly empty vector of board cards
 	void _set_call_matrix(const ArrayX& board);
 
-	//-- - Sets the evaluator's fold matrix, which gives the equity for terminal
-	//	--nodes where one player has folded.
-	//	--
-	//	--Creates the matrix `B` such that for player ranges `x` and `y`, `x'By` is the equity
-	//	-- for the player who doesn't fold
-	//	-- @param board a possibly empty vector of board cards
-	void _set_fold_matrix(const ArrayX& board);
+	//-- - Sets the mask of the hands that the board does not block, which is all that @{fold_value} needs.
+	//-- @param board a possibly empty vector of board cards
+	void _set_possible_hands(const ArrayX& board);
+
+	//-- - Sorts the possible hands of a last round board by strength for @{sorted_call_value}.
+	//-- @param board a non - empty vector of board cards
+	void _set_strength_order(const ArrayX& board);
+
+	//-- - Multiplies the ranges by the call matrix. The result must not share memory with the ranges.
+	//--
+	//--The last round values come from @{sorted_call_value} instead if @{arguments.sorted_showdown} is set.
+	template <typename Derived>
+	void call_value(const ArrayBase<Derived> & ranges, ArrayBase<Derived> & result) const
+	{
+		if (sorted_showdown && !_strength_order.empty())
+		{
+			sorted_call_value(ranges, result);
+		}
+		else
+		{
+			assert(_call_matrix.size() > 0 && "the board is stored in the sorted form");
+			result.matrix().noalias() = ranges.matrix() * _call_matrix.matrix();
+		}
+	}
 
+	//-- - Computes the same values as the call matrix of a last round board from the hands sorted by strength.
+	//--
+	//--Lower strength values of @{LeducEvaluator.batch_eval} are better, so a hand wins the opponent range
+	//-- of the larger values and loses the one of the smaller values. Both are running sums over the sorted
+	//-- hands, so the cost is linear in the number of hands. The hands that share a card with the board are
+	//-- left out. The only other hand that a hand blocks is the same card, which ties with it and adds nothing.
+	//-- @param ranges [rows x card_count] ranges, one per row
+	//-- @param result [rows x card_count] values of the ranges against every hand, must not share memory with the ranges
 	template <typename Derived>
-	void call_value(const ArrayBase<Derived> & ranges, ArrayBase<Derived> & result)
+	void sorted_call_value(const ArrayBase<Derived> & ranges, ArrayBase<Derived> & result) const
 	{
-		result = ranges.matrix() * _equity_matrix.matrix();
+		assert(!_strength_order.empty() && "only the last round boards have a strength order");
+		_sorted_values(ranges, result, _strength_order);
 	}
 
+	//-- - Computes the values of the ranges from the hands sorted by strength, see @{sorted_call_value}.
+	//-- @param ranges [rows x K] ranges, one per row
+	//-- @param result [rows x K] values of the ranges against every hand, must not share memory with the ranges
+	//-- @param order the column of every hand by increasing strength value, grouped by @{_strength_groups}
 	template <typename Derived>
-	void fold_value(const ArrayBase<Derived> & ranges, ArrayBase<Derived> & result)
+	void _sorted_values(const ArrayBase<Derived> & ranges, ArrayBase<Derived> & result, const vector<int>& order) const
 	{
-		assert(_fold_matrix.size() > 0);
-		result = (ranges.matrix() * _fold_matrix.matrix()).array();
+		const int last_group = (int)_strength_groups.size() - 2;
+
+		//--the hands blocked by the board have no value
+		result.setZero();
+
+		//--the value of a hand is the range of the worse hands minus the one of the better hands. Going from a group of
+		//--equally strong hands to the next better one, the worse hands gain the group and the better hands lose the next one.
+		//--Every step works on all the rows at once.
+		const int top = order[_strength_groups[last_group]];
+
+		for (int i = 0; i < _strength_groups[last_group]; i++)
+		{
+			result.col(top) -= ranges.col(order[i]);
+		}
+
+		for (int group = last_group - 1; group >= 0; group--)
+		{
+			const int hand = order[_strength_groups[group]];
+			const int above = order[_strength_groups[group + 1]];
+			result.col(hand) = result.col(above);
+
+			for (int i = _strength_groups[group]; i < _strength_groups[group + 2]; i++)
+			{
+				result.col(hand) += ranges.col(order[i]);
+			}
+		}
+
+		//--the other hands of a group have the value of its first hand
+		for (int group = 0; group <= last_group; group++)
+		{
+			const int hand = order[_strength_groups[group]];
+
+			for (int i = _strength_groups[group] + 1; i < _strength_groups[group + 1]; i++)
+			{
+				result.col(order[i]) = result.col(hand);
+			}
+		}
+	}
+
+	//-- - Computes the equity for terminal nodes where one player has folded, in linear time.
+	//-- The result must not share memory with the ranges.
+	//--
+	//--A hand wins the opponent range over the possible hands minus the mass that it blocks, which in
+	//-- Leduc variants is the opponent holding the same card.
+	//-- @param ranges [rows x card_count] ranges, one per row
+	//-- @param result [rows x card_count] values of the ranges against every hand
+	template <typename Derived>
+	void fold_value(const ArrayBase<Derived> & ranges, ArrayBase<Derived> & result) const
+	{
+		assert(_possible_hands.size() > 0);
+
+		for (int row = 0; row < ranges.rows(); row++)
+		{
+			const float total = (ranges.row(row) * _possible_hands).sum();
+			result.row(row) = (total - ranges.row(row)) * _possible_hands;
+		}
+	}
+
+	//-- - Computes @{call_value} for ranges in the compact hand space of the board, see @{card_tools.get_possible_hands}.
+	//--
+	//--No column is blocked by the board, so the kernels touch only the possible hands.
+	//-- @param ranges [rows x hands] ranges, one per row
+	//-- @param result [rows x hands] values of the ranges against every hand, must not share memory with the ranges
+	template <typename Derived>
+	void compact_call_value(const ArrayBase<Derived> & ranges, ArrayBase<Derived> & result) const
+	{
+		assert(ranges.cols() == _hands_count);
+
+		if (sorted_showdown && !_compact_strength_order.empty())
+		{
+			_sorted_values(ranges, result, _compact_strength_order);
+		}
+		else
+		{
+			assert(_compact_call_matrix.size() > 0 && "the board is stored in the sorted form");
+			result.matrix().noalias() = ranges.matrix() * _compact_call_matrix.matrix();
+		}
+	}
+
+	//-- - Computes @{fold_value} for ranges in the compact hand space of the board.
+	//-- @param ranges [rows x hands] ranges, one per row
+	//-- @param result [rows x hands] values of the ranges against every hand
+	template <typename Derived>
+	void compact_fold_value(const ArrayBase<Derived> & ranges, ArrayBase<Derived> & result) const
+	{
+		assert(ranges.cols() == _hands_count);
+
+		for (int row = 0; row < ranges.rows(); row++)
+		{
+			const float total = ranges.row(row).sum();
+			result.row(row) = total - ranges.row(row);
+		}
 	}
 
 	//	-- - Computes the counterfactual values that both players achieve at a terminal node
@@ -75,7 +225,7 @@ public:
 	//-- @param ranges a 2xK tensor containing ranges for each player(where K is the range size)
 	//-- @param result a 2xK tensor in which to store the cfvs for each player
 	//-- @param folding_player which player folded
-	void tree_node_fold_value(const ArrayXX& ranges, ArrayXX& result, int folding_player);
+	void tree_node_fold_value(const ArrayXX& ranges, ArrayXX& result, int folding_player) const;
 
 	//-- - Returns the matrix which gives showdown equity for any ranges.
 	//--
@@ -85,7 +235,7 @@ public:
 	//-- @return For nodes in the last betting round, the matrix `A` such that for player ranges
 	//-- `x` and `y`, `x'Ay` is the equity for the first player when no player folds.For nodes
 	//-- in the first betting round, the weighted average of all such possible matrices.
-	ArrayXX get_call_matrix();
+	ArrayXX get_call_matrix() const;
 
 	//-- - Computes the counterfactual values that both players achieve at a terminal node
 	//-- where no player has folded.
@@ -95,8 +245,18 @@ public:
 	//--
 	//-- @param ranges a 2xK tensor containing ranges for each player(where K is the range size)
 	//-- @param result a 2xK tensor in which to store the cfvs for each player
-	void tree_node_call_value(const ArrayXX& ranges, ArrayXX& result);
+	void tree_node_call_value(const ArrayXX& ranges, ArrayXX& result) const;
 
+	//-- - Computes @{tree_node_fold_value} for ranges in the compact hand space of the board.
+	//-- @param ranges a 2xH tensor containing ranges for each player over the possible hands
+	//-- @param result a 2xH tensor in which to store the cfvs for each player
+	//-- @param folding_player which player folded
+	void tree_node_compact_fold_value(const AmAxx& ranges, AmAxx& result, int folding_player) const;
+
+	//-- - Computes @{tree_node_call_value} for ranges in the compact hand space of the board.
+	//-- @param ranges a 2xH tensor containing ranges for each player over the possible hands
+	//-- @param result a 2xH tensor in which to store the cfvs for each player
+	void tree_node_compact_call_value(const AmAxx& ranges, AmAxx& result) const;
 
 //private: ToDo:Remove after testing
 
@@ -106,7 +266,34 @@ public:
 
 	ArrayXX _equity_matrix;
 
-	ArrayXX _fold_matrix;
+	// The hands that do not share a card with a last round board, by increasing strength value.
+	// Empty for the first round, whose values average over the boards.
+	vector<int> _strength_order;
+
+	// Index of the first hand of every group of equally strong hands in @{_strength_order}. The last element is its size.
+	vector<int> _strength_groups;
+
+	// @{_strength_order} as columns of the compact hand space
+	vector<int> _compact_strength_order;
+
+	// [hands x hands] call matrix of the compact hand space
+	ArrayXX _compact_equity_matrix;
+
+	// The number of hands that the board does not block, the width of the compact hand space
+	int _hands_count = 0;
+
+	// The call matrices that the kernels read: @{_equity_matrix} and @{_compact_equity_matrix}, or the
+	// pages of an @{EquityStore}. Empty for a last round board loaded in the sorted form.
+	Map<const ArrayXX> _call_matrix = Map<const ArrayXX>(nullptr, 0, 0);
+	Map<const ArrayXX> _compact_call_matrix = Map<const ArrayXX>(nullptr, 0, 0);
+
+	//-- - Points the kernels to call matrices.
+	//-- @param call_matrix [card_count x card_count] call matrix, or null for none
+	//-- @param compact_call_matrix [hands x hands] call matrix of the compact hand space, or null for none
+	void _view_call_matrices(const float* call_matrix, const float* compact_call_matrix);
+
+	// [1 x card_count] mask of the hands that do not share a card with the board, for @{fold_value}
+	ArrayXX _possible_hands;
 };
 
 //#include "terminal_equity.npp"
\ No newline at end of file
@@ -22,7 +22,8 @@ vector<Node*> tree_builder::_get_children_nodes_chance_node(Node& parent_node)
 		return vector<Node*>();
 	}
 
-	ArrayXX next_boards = _card_tools.get_second_round_boards();
+	vector<vector<CardPermutation>> board_permutations;
+	ArrayXX next_boards = _suit_isomorphism ? _card_tools.get_canonical_second_round_boards(board_permutations) : _card_tools.get_second_round_boards();
 	size_t next_boards_count = next_boards.rows();
 
 	long long subtree_height = -1;
@@ -42,6 +43,11 @@ vector<Node*> tree_builder::_get_children_nodes_chance_node(Node& parent_node)
 		child->board_string = next_board_string;
 		child->bets = parent_node.bets;
 
+		if (_suit_isomorphism)
+		{
+			child->suit_permutations = board_permutations[i];
+		}
+
 		children.push_back(child);
 	}
 
@@ -229,6 +235,7 @@ Node* tree_builder::build_tree(TreeBuilderParams& params)
 	assert(params.bet_sizing.size() != 0);
 	_bet_sizing = params.bet_sizing;
 	_limit_to_street = params.limit_to_street;
+	_suit_isomorphism = params.suit_isomorphism;
 	_build_tree_dfs(*root);
 
 	if (root->bets(0) == root->bets(1)) // Just as in original for testing. ToDo: remove and uncommented code below!!!
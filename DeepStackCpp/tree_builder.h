@@ -52,6 +52,8 @@ public:
 	//		--
 	//		-- * `limit_to_street`: if `true`, only build the current betting round
 	//		--
+	//		-- * `suit_isomorphism`: if `true`, build one chance child per class of suit-isomorphic boards
+	//		--
 	//		-- * `bet_sizing` (optional) : a @{bet_sizing} object which gives the allowed
 	//	    -- bets for each player
 	//      -- @return the root node of the built tree
@@ -61,7 +63,10 @@ public:
 	bet_sizing_manager _bet_sizing_manager;
 
 	// if `true`, only build the current betting round
-	bool _limit_to_street;
+	bool _limit_to_street = false;
+
+	// if `true`, build one chance child per class of suit-isomorphic boards
+	bool _suit_isomorphism = false;
 
 	// object which gives the allowed bets for each player
 	VectorX _bet_sizing;
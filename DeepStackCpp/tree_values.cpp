@@ -5,162 +5,149 @@
 
 tree_values::tree_values(){}
 
-void tree_values::_fill_ranges_dfs(Node & node, ArrayXX & ranges_absolute)
+void tree_values::_fill_ranges(FlatTree& tree)
 {
-	node.ranges = ranges_absolute;
+	AmAxx strategy = tree.strategy();
 
-	if (node.terminal)
+	for (int node = 0; node < tree.nodes_count; node++)
 	{
-		return;
-	}
-
-	assert(node.strategy.size() > 0);
+		if (tree.terminal[node])
+		{
+			continue;
+		}
 
-	const int actions_count = (int)node.children.size();
-	const int currentPlayerIndex = node.current_player;
-	const int opponentIndex = 1 - node.current_player;
+		const int first = tree.first_child[node];
+		const int actions_count = tree.children_count[node];
+		const int width = tree.width[node];
+		const int currentPlayerIndex = tree.current_player[node];
+		const int opponentIndex = 1 - tree.current_player[node];
+		auto node_strategy = strategy.middleRows(first, actions_count);
 
-	//--check that it's a legal strategy
-	ArrayXX strategy_to_check = node.strategy;
+		assert(actions_count > 0);
 
-	if (node.current_player != chance)
-	{
-		ArrayX checksum = strategy_to_check.colwise().sum();
-		assert((strategy_to_check > 0.f).all());
-		assert((strategy_to_check < 1.001f).all());
-		assert((checksum > 0.999f).all());
-		assert((checksum < 1.001f).all());
-	}
+		//--check that it's a legal strategy, the unused columns of a compact tree hold no hand
+		if (currentPlayerIndex != chance)
+		{
+			ArrayXX checksum = node_strategy.leftCols(width).colwise().sum();
+			assert((node_strategy.leftCols(width) >= 0.f).all()); // the lookahead trees mask out the fold when there is a free call
+			assert((node_strategy.leftCols(width) < 1.001f).all());
+			assert((checksum > 0.999f).all());
+			assert((checksum < 1.001f).all());
+		}
 
-	assert((node.ranges >= 0).all());
-	assert((node.ranges < 1).all());
+		assert((tree.ranges(P1).row(node) >= 0).all() && (tree.ranges(P2).row(node) >= 0).all());
+		assert((tree.ranges(P1).row(node) < 1).all() && (tree.ranges(P2).row(node) < 1).all());
 
-	//--check if the range consists only of cards that don't overlap with the board
+		//--check if the range consists only of cards that don't overlap with the board, a compact tree has no such hands
 
 #ifdef _DEBUG
-	ArrayXX hands_mask = _cardTools.get_possible_hand_indexes(node.board);
-	hands_mask.resize(1, card_count);
-	hands_mask = Util::ExpandAs(hands_mask, node.ranges);
-
-	assert((hands_mask * node.ranges).sum() == node.ranges.sum()); // Checking that multiplication with possible hands range did not changed anything.
+		if (!tree.compact)
+		{
+			const CardArray& hands_mask = _cardTools.get_possible_hand_indexes(tree.board(node));
 
-	//impossible_hands_mask.conservativeResize(1, card_count);
-	//Util::ExpandAs(impossible_hands_mask, node.ranges_absolute);
-	//float impossible_range_sum = impossible_hands_mask.sum();
-	//assert(impossible_range_sum == 0)
+			// Checking that multiplication with possible hands range did not changed anything.
+			assert((tree.ranges(P1).row(node) * hands_mask.transpose()).sum() == tree.ranges(P1).row(node).sum());
+			assert((tree.ranges(P2).row(node) * hands_mask.transpose()).sum() == tree.ranges(P2).row(node).sum());
+		}
 #endif
 
-	//actions_count X [players_count, card_count]
-	//vector<ArrayXX&> children_ranges_absolute(actions_count);
-	ArrayXX child_range(players_count, card_count);
-
-	//--chance player
-	if (node.current_player == chance)
-	{
-		for (size_t i = 0; i < actions_count; i++)
+		//--chance player
+		if (currentPlayerIndex == chance)
 		{
-			child_range.row(0) = node.ranges.row(0) * node.strategy.row(i);
-			child_range.row(1) = node.ranges.row(1) * node.strategy.row(i);
-
-			//--go deeper
-			_fill_ranges_dfs(*node.children[i], child_range);
+			for (int player = P1; player <= P2; player++)
+			{
+				tree.fill_chance_children(tree.ranges(player), strategy, node);
+			}
 		}
-	}
-			
-	else //--player
-	{
-
-		for (size_t i = 0; i < actions_count; i++)
+		else //--player
 		{
+			AmAxx playerRanges = tree.ranges(currentPlayerIndex);
+			AmAxx opponentRanges = tree.ranges(opponentIndex);
+
 			//--copy the range for the non-acting player  
-			child_range.row(opponentIndex) = node.ranges.row(opponentIndex);
+			opponentRanges.middleRows(first, actions_count) = opponentRanges.row(node).replicate(actions_count, 1);
 
 			//  --multiply the range for the acting player using his strategy    
-			child_range.row(currentPlayerIndex) = node.ranges.row(currentPlayerIndex) * node.strategy.row(i);
-
-			//--go deeper
-			_fill_ranges_dfs(*node.children[i], child_range);
+			playerRanges.middleRows(first, actions_count) = node_strategy.rowwise() * playerRanges.row(node);
 		}
 	}
 }
 
-void tree_values::_compute_values_dfs(Node& node)
+void tree_values::_compute_values(FlatTree& tree)
 {
-	const int opponent = 1 - node.current_player;
-	const int current_player = node.current_player;
+	AmAxx strategy = tree.strategy();
+	_terminal_ranges = ArrayXX::Zero(players_count, card_count);
+	_terminal_values = ArrayXX::Zero(players_count, card_count);
 
-	//--compute values using terminal_equity in terminal nodes
-	if (node.terminal)
+	for (int node = tree.nodes_count - 1; node >= 0; node--)
 	{
-		assert(node.type == terminal_fold || node.type == terminal_call);
-
-		_terminal_equity.set_board(node.board);
-
-		ArrayXX values = ArrayXX::Zero(players_count, card_count);
+		const int opponent = 1 - tree.current_player[node];
+		const int current_player = tree.current_player[node];
 
-		if (node.type == terminal_fold)
+		//--compute values using terminal_equity in terminal nodes
+		if (tree.terminal[node])
 		{
-			_terminal_equity.tree_node_fold_value(node.ranges, values, opponent);
-		}
-		else
-		{
-			_terminal_equity.tree_node_call_value(node.ranges, values);
-		}
+			assert(tree.type[node] == terminal_fold || tree.type[node] == terminal_call);
 
-		//--multiply by the pot
-		values *= node.pot;
-		node.cf_values = ArrayXX(values);
-		node.cf_values_br = ArrayXX(values);
-	}
-	else
-	{
-
-		const int actions_count = (int)node.children.size();
-		//[players_count x card_count][actions_count]
-		node.cf_values = ArrayXX::Zero(players_count, card_count);
-		node.cf_values_br = ArrayXX::Zero(players_count, card_count); 
+			const terminal_equity& termEquity = TerminalEquityRegistry::instance().get(tree.board(node));
+			const int width = tree.width[node];
 
-		for (size_t i = 0; i < actions_count; i++)
-		{
-			Node* child_node = node.children[i];
-			_compute_values_dfs(*child_node);
+			//--the buffers hold the used columns of the node one row after another, all of them unless the tree is compact
+			AmAxx ranges(_terminal_ranges.data(), players_count, width);
+			AmAxx values(_terminal_values.data(), players_count, width);
+			ranges.row(P1) = tree.ranges(P1).row(node).leftCols(width);
+			ranges.row(P2) = tree.ranges(P2).row(node).leftCols(width);
 
-			if (current_player == chance) // ToDo: move check outside the loop and check performance
+			if (tree.compact && tree.type[node] == terminal_fold)
+			{
+				termEquity.tree_node_compact_fold_value(ranges, values, opponent);
+			}
+			else if (tree.compact)
+			{
+				termEquity.tree_node_compact_call_value(ranges, values);
+			}
+			else if (tree.type[node] == terminal_fold)
 			{
-				node.cf_values += child_node->cf_values;
-				node.cf_values_br += child_node->cf_values_br;
+				termEquity.tree_node_fold_value(_terminal_ranges, _terminal_values, opponent);
 			}
 			else
 			{
-				node.cf_values.row(current_player) += child_node->cf_values.row(current_player) * node.strategy.row(i);
-				node.cf_values.row(opponent) += child_node->cf_values.row(opponent);
+				termEquity.tree_node_call_value(_terminal_ranges, _terminal_values);
+			}
 
-				node.cf_values_br.row(opponent) += child_node->cf_values_br.row(opponent);
+			//--multiply by the pot
+			for (int player = P1; player <= P2; player++)
+			{
+				tree.cf_values(player).row(node).leftCols(width) = values.row(player) * tree.pot[node];
+				tree.cf_values_br(player).row(node) = tree.cf_values(player).row(node);
+			}
+		}
+		else
+		{
+			const int first = tree.first_child[node];
+			const int actions_count = tree.children_count[node];
 
-				if (i == 0)
-				{
-					node.cf_values_br.row(current_player) = child_node->cf_values_br.row(current_player);
-				}
-				else
+			if (current_player == chance)
+			{
+				for (int player = P1; player <= P2; player++)
 				{
-					node.cf_values_br.row(current_player) = node.cf_values_br.row(current_player).max(child_node->cf_values_br.row(current_player));
+					tree.sum_chance_children(tree.cf_values(player), node);
+					tree.sum_chance_children(tree.cf_values_br(player), node);
 				}
 			}
+			else
+			{
+				AmAxx playerCfValues = tree.cf_values(current_player);
+				AmAxx playerCfValuesBr = tree.cf_values_br(current_player);
+
+				playerCfValues.row(node) = (playerCfValues.middleRows(first, actions_count) * strategy.middleRows(first, actions_count)).colwise().sum();
+				tree.cf_values(opponent).row(node) = tree.cf_values(opponent).middleRows(first, actions_count).colwise().sum();
+
+				tree.cf_values_br(opponent).row(node) = tree.cf_values_br(opponent).middleRows(first, actions_count).colwise().sum();
+				playerCfValuesBr.row(node) = playerCfValuesBr.middleRows(first, actions_count).colwise().maxCoeff();
+			}
 		}
 	}
-
-	//--counterfactual values weighted by the reach prob
-	node.cfv_infset = ArrayX(players_count);
-	node.cfv_infset.row(P1) = node.cf_values.row(P1).matrix().dot(node.ranges.row(P1).matrix());
-	node.cfv_infset.row(P2) = node.cf_values.row(P2).matrix().dot(node.ranges.row(P2).matrix());
-
-	//--compute CFV - BR values weighted by the reach prob
-	node.cfv_br_infset = ArrayX(players_count);
-	node.cfv_br_infset.row(P1) = node.cf_values_br.row(P1).matrix().dot(node.ranges.row(P1).matrix());
-	node.cfv_br_infset.row(P2) = node.cf_values_br.row(P2).matrix().dot(node.ranges.row(P2).matrix());
-	
-	node.epsilon = node.cfv_br_infset - node.cfv_infset;
-	node.exploitability = node.epsilon.mean();
 }
 
 void tree_values::compute_values(Node& root, ArrayXX* starting_ranges)
@@ -186,7 +173,56 @@ void tree_values::compute_values(Node& root, ArrayXX* starting_ranges)
 	assert((range >= 0).all());
 #endif
 
-	//--3.0 compute the values
-	_fill_ranges_dfs(root, range);
-	_compute_values_dfs(root);
+	//--3.0 compute the values on the possible hands of every board
+	FlatTree tree(root, 1, true);
+	tree.import_row(tree.ranges(P1), 0, range.row(P1));
+	tree.import_row(tree.ranges(P2), 0, range.row(P2));
+
+	_fill_ranges(tree);
+	_compute_values(tree);
+	tree.export_to_nodes();
+
+	//--4.0 infoset values and exploitability of every node
+	for (int i = 0; i < tree.nodes_count; i++)
+	{
+		Node& node = *tree.nodes[i];
+
+		//--counterfactual values weighted by the reach prob
+		node.cfv_infset = ArrayX(players_count);
+		node.cfv_infset.row(P1) = node.cf_values.row(P1).matrix().dot(node.ranges.row(P1).matrix());
+		node.cfv_infset.row(P2) = node.cf_values.row(P2).matrix().dot(node.ranges.row(P2).matrix());
+
+		//--compute CFV - BR values weighted by the reach prob
+		node.cfv_br_infset = ArrayX(players_count);
+		node.cfv_br_infset.row(P1) = node.cf_values_br.row(P1).matrix().dot(node.ranges.row(P1).matrix());
+		node.cfv_br_infset.row(P2) = node.cf_values_br.row(P2).matrix().dot(node.ranges.row(P2).matrix());
+
+		node.epsilon = node.cfv_br_infset - node.cfv_infset;
+		node.exploitability = node.epsilon.mean();
+	}
+}
+
+float tree_values::compute_exploitability(FlatTree& tree, const ArrayXX& starting_ranges)
+{
+	assert(tree.batch_size == 1);
+	tree.import_row(tree.ranges(P1), 0, starting_ranges.row(P1));
+	tree.import_row(tree.ranges(P2), 0, starting_ranges.row(P2));
+
+	_fill_ranges(tree);
+	_compute_values(tree);
+
+	//--best response gain of every player weighted by the reach prob
+	float epsilon = 0;
+
+	for (int player = P1; player <= P2; player++)
+	{
+		epsilon += ((tree.cf_values_br(player).row(0) - tree.cf_values(player).row(0)) * tree.ranges(player).row(0)).sum();
+	}
+
+	return epsilon / players_count;
+}
+
+float tree_values::to_units(float chips, exploitability_units units)
+{
+	return units == exploitability_mbb ? chips * 1000 / ante : chips;
 }
@@ -1,6 +1,8 @@
 #pragma once
 #include "Node.h"
+#include "FlatTree.h"
 #include "terminal_equity.h"
+#include "TerminalEquityRegistry.h"
 #include "assert.h"
 #include "Util.h"
 #include "arguments.h"
@@ -16,29 +18,28 @@ public:
 	tree_values();
 
 //private:
-	terminal_equity _terminal_equity;
-
 	card_tools _cardTools;
 
-	//-- - Recursively walk the tree and calculate the probability of reaching each
+	// [players_count x card_count] buffers for the terminal equity evaluation
+	ArrayXX _terminal_ranges;
+	ArrayXX _terminal_values;
+
+	//-- - Walk the tree from the root and calculate the probability of reaching each
 	//-- node using the saved strategy profile.
 	//--
-	//--The reach probabilities are saved in the `ranges_absolute` field of each
-	//-- node.
-	//-- @param node the current node of the tree
-	//-- @param ranges_absolute a 2xK tensor containing the probabilities of each
-	//-- player reaching the current node with each private hand
-	void _fill_ranges_dfs(Node& node, ArrayXX& ranges_absolute);
-
-	//-- - Recursively calculate the counterfactual values for each player at each
+	//--The reach probabilities are saved in the `ranges` planes of the tree.
+	//-- @param tree the flattened tree, the root ranges must be already set
+	void _fill_ranges(FlatTree& tree);
+
+	//-- - Walk the tree from the leaves and calculate the counterfactual values for each player at each
 	//	-- node of the tree using the saved strategy profile.
 	//	--
 	//	--The cfvs for each player in the given strategy profile when playing against
 	//	-- each other is stored in the `cf_values` field for each node.The cfvs for
 	//	--a best response against each player in the profile are stored in the
 	//	-- `cf_values_br` field for each node.
-	//	-- @param node the current node
-	void _compute_values_dfs(Node& node);
+	//	-- @param tree the flattened tree
+	void _compute_values(FlatTree& tree);
 
 	//-- - Compute the self play and best response values of a strategy profile on
 	//	-- the given game tree.
@@ -53,5 +54,20 @@ public:
 	//	-- @param[opt] starting_ranges probability vectors over player private hands
 	//	-- at the root node(default uniform)
 	void compute_values(Node& root, ArrayXX* starting_ranges = nullptr);
+
+	//-- - Computes the exploitability of the strategy saved in the `strategy` plane of
+	//-- a flat tree, without going through the @{Node} graph.
+	//--
+	//--Overwrites the ranges and the values planes of the tree.
+	//-- @param tree the flattened tree of a single situation
+	//-- @param starting_ranges probability vectors over player private hands at the root node
+	//-- @return the mean over the players of the best response gain at the root, in chips
+	float compute_exploitability(FlatTree& tree, const ArrayXX& starting_ranges);
+
+	//-- - Converts an exploitability in chips to the given units.
+	//-- @param chips the exploitability in chips per hand
+	//-- @param units one of @{constants.exploitability_units}, mbb are thousandths of the ante
+	//-- @return the exploitability in the units
+	static float to_units(float chips, exploitability_units units);
 };
 
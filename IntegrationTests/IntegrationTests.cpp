@@ -16,6 +16,7 @@
 #include "data_generation.h"
 #include "lookahead.h"
 #include "TreeCFR.h"
+#include "EquityStore.h"
 #include <Eigen/Dense>
 #include <iostream>
 #include <ctime>
@@ -74,8 +75,9 @@ void test_tree_cfr()
 	starting_ranges.row(0) = cradTools.get_uniform_range(params.root_node->board);
 	starting_ranges.row(1) = cradTools.get_uniform_range(params.root_node->board);
 
-	TreeCFR tree_cfr;
-	tree_cfr.run_cfr(*tree, starting_ranges, 100000, 499);
+	const int threads_count = thread::hardware_concurrency() > 0 ? (int)thread::hardware_concurrency() : 1;
+	TreeCFR tree_cfr(cfr_plus);
+	tree_cfr.run_cfr(*tree, starting_ranges, 2000, 0, threads_count);
 
 	tree_values tv;
 	tv.compute_values(*tree, &starting_ranges);
@@ -173,6 +175,30 @@ void TestTreeLookahed()
 
 }
 
+//-- - Times the per node and the layer-wise lookahead engines on the same re-solve.
+void BenchmarkLookaheads()
+{
+	Node node;
+	card_to_string_conversion converter;
+	node.board = converter.string_to_board("Ks");
+	node.street = 2;
+	node.current_player = P1;
+	node.bets << 800, 800;
+
+	card_tools tools;
+	ArrayX player_range = tools.get_uniform_range(node.board);
+	ArrayX op_cfvs(card_count);
+	op_cfvs << -500, 0, 700, -900, 800, 1200;
+
+	for (int layers = 0; layers <= 1; layers++)
+	{
+		Resolving resolver(layers == 1);
+		clock_t begin = clock();
+		LookaheadResult result = resolver.resolve(node, player_range, op_cfvs);
+		double elapsed_secs = double(clock() - begin) / CLOCKS_PER_SEC;
+		cout << (layers == 1 ? "lookahead: " : "TreeLookahed: ") << elapsed_secs << "s" << endl;
+	}
+}
 
 void TestRangeGenPerf()
 {
@@ -201,13 +227,38 @@ void TestRangeGenPerf()
 	cout << sum(0) << endl;
 }
 
-int main()
+//-- - Writes the terminal equities of every board to @{arguments.equity_store_path}, see @{EquityStore}.
+//-- @param dense whether the last round boards keep their call matrices, or only their strength order
+//-- @return the exit code of the process
+int WriteEquityStore(bool dense)
 {
+	clock_t begin = clock();
+
+	if (!EquityStore::write(equity_store_path, dense))
+	{
+		cerr << "Could not write " << equity_store_path << endl;
+		return 1;
+	}
+
+	double elapsed_secs = double(clock() - begin) / CLOCKS_PER_SEC;
+	cout << "Wrote " << equity_store_path << (dense ? " (dense) in " : " (sorted) in ") << elapsed_secs << "s" << endl;
+	return 0;
+}
+
+int main(int argc, char* argv[])
+{
+	//--`IntegrationTests equity_store [sorted]` writes the equity store offline, built for the game of the configuration
+	if (argc > 1 && string(argv[1]) == "equity_store")
+	{
+		return WriteEquityStore(!(argc > 2 && string(argv[2]) == "sorted"));
+	}
+
 	clock_t begin = clock();
 	//test_tree_visualiser();
 	//test_run_cfr();
 	//test_tree_visualiser();
 	//Resolve();
+	//BenchmarkLookaheads();
 	clock_t end = clock();
 	double elapsed_secs = double(end - begin) / CLOCKS_PER_SEC;
 	cout << elapsed_secs << endl;
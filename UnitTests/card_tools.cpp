@@ -1,9 +1,11 @@
 #include "catch.hpp"
 #include "Node.h"
 #include "card_tools.h"
+#include "CardSet.h"
 #include <string>
+#include <set>
 
-TEST_CASE("hand_is_possible")
+TEST_CASE("hand_is_possible", "[leduc]")
 {
 	card_tools cardTools;
 
@@ -21,7 +23,7 @@ TEST_CASE("hand_is_possible")
 	REQUIRE(!cardTools.hand_is_possible(hand3));
 }
 
-TEST_CASE("get_possible_hand_indexes")
+TEST_CASE("get_possible_hand_indexes", "[leduc]")
 {
 	card_tools cardTools;
 
@@ -59,7 +61,7 @@ TEST_CASE("get_possible_hand_indexes")
 	REQUIRE(result(5));
 }
 
-TEST_CASE("get_impossible_hand_indexes")
+TEST_CASE("get_impossible_hand_indexes", "[leduc]")
 {
 	card_tools cardTools;
 
@@ -75,7 +77,7 @@ TEST_CASE("get_impossible_hand_indexes")
 	REQUIRE(!result(5));
 }
 
-TEST_CASE("get_uniform_range")
+TEST_CASE("get_uniform_range", "[leduc]")
 {
 	card_tools cardTools;
 	ArrayX board(1);
@@ -91,7 +93,7 @@ TEST_CASE("get_uniform_range")
 	REQUIRE(result(5) == koef);
 }
 
-TEST_CASE("get_random_range")
+TEST_CASE("get_random_range", "[leduc]")
 {
 	card_tools cardTools;
 	ArrayX board(1);
@@ -106,7 +108,7 @@ TEST_CASE("get_random_range")
 	REQUIRE(result(5) > 0);
 }
 
-TEST_CASE("is_valid_range")
+TEST_CASE("is_valid_range", "[leduc]")
 {
 	card_tools cardTools;
 	ArrayX board(1);
@@ -119,23 +121,120 @@ TEST_CASE("is_valid_range")
 	REQUIRE(!cardTools.is_valid_range(result, board));
 }
 
+//--the number of ways to choose k of n cards
+static long long choose(int n, int k)
+{
+	long long result = 1;
+	for (int i = 1; i <= k; i++)
+	{
+		result = result * (n - k + i) / i;
+	}
+
+	return result;
+}
+
 TEST_CASE("get_boards_count")
 {
 	card_tools cardTools;
-	REQUIRE(cardTools.get_boards_count() == 6);
+	REQUIRE(cardTools.get_boards_count() == choose(card_count, board_card_count));
 }
 
 TEST_CASE("get_second_round_boards")
 {
 	card_tools cardTools;
 	ArrayXX boards = cardTools.get_second_round_boards();
-	REQUIRE(boards(0, 0) == 0);
-	REQUIRE(boards(1, 0) == 1);
-	REQUIRE(boards(2, 0) == 2);
-	REQUIRE(boards(3, 0) == 3);
-	REQUIRE(boards(4, 0) == 4);
-	REQUIRE(boards(5, 0) == 5);
-	REQUIRE(boards.rows() == card_count);
+	REQUIRE(boards.rows() == cardTools.get_boards_count());
+	REQUIRE(boards.cols() == board_card_count);
+
+	if (board_card_count == 1)
+	{
+		for (int card = 0; card < card_count; card++)
+		{
+			REQUIRE(boards(card, 0) == card);
+		}
+	}
+
+	//--the row of every board is its index, whatever the board size
+	set<uint64_t> masks;
+	for (int board = 0; board < boards.rows(); board++)
+	{
+		ArrayX cards = boards.row(board);
+		REQUIRE(CardSet(cards).size() == board_card_count);
+		REQUIRE(cardTools.get_board_index(cards) == board);
+		masks.insert(CardSet(cards).mask());
+	}
+
+	REQUIRE(masks.size() == boards.rows());
+}
+
+TEST_CASE("get_possible_boards_count")
+{
+	card_tools cardTools;
+	REQUIRE(cardTools.get_possible_boards_count() == choose(card_count - 2, board_card_count));
+
+	//--every board that two distinct private cards do not block
+	ArrayXX boards = cardTools.get_second_round_boards();
+	long long possible = 0;
+
+	for (int board = 0; board < boards.rows(); board++)
+	{
+		const CardSet cards(ArrayX(boards.row(board)));
+		possible += !cards.contains(0) && !cards.contains(1) ? 1 : 0;
+	}
+
+	REQUIRE(cardTools.get_possible_boards_count() == possible);
+}
+
+TEST_CASE("get_canonical_second_round_boards")
+{
+	card_tools cardTools;
+	vector<CardPermutation> permutations = cardTools.get_suit_permutations();
+	REQUIRE(permutations.size() == 2);
+
+	for (int card = 0; card < card_count; card++)
+	{
+		REQUIRE(permutations[0][card] == card);
+		REQUIRE(permutations[1][card] == (card % 2 == 0 ? card + 1 : card - 1));
+	}
+
+	vector<vector<CardPermutation>> board_permutations;
+	ArrayXX boards = cardTools.get_canonical_second_round_boards(board_permutations);
+	REQUIRE(board_permutations.size() == boards.rows());
+
+	if (board_card_count == 1)
+	{
+		REQUIRE(boards.rows() == rank_count);
+
+		for (int board = 0; board < boards.rows(); board++)
+		{
+			//--one board of each rank, standing for the boards of both suits
+			REQUIRE(boards(board, 0) == board * suit_count);
+			REQUIRE(board_permutations[board].size() == suit_count);
+
+			ArrayX representative = boards.row(board);
+			ArrayX image = cardTools.permute_board(representative, board_permutations[board][1]);
+			REQUIRE(image(0) == board * suit_count + 1);
+		}
+	}
+
+	//--the classes cover every board exactly once
+	set<uint64_t> covered;
+	size_t images = 0;
+
+	for (int board = 0; board < boards.rows(); board++)
+	{
+		ArrayX representative = boards.row(board);
+		REQUIRE(board_permutations[board][0] == permutations[0]);
+
+		for (const CardPermutation& permutation : board_permutations[board])
+		{
+			covered.insert(CardSet(cardTools.permute_board(representative, permutation)).mask());
+			images++;
+		}
+	}
+
+	REQUIRE(images == cardTools.get_boards_count());
+	REQUIRE(covered.size() == images);
 }
 
 TEST_CASE("get_board_index")
@@ -155,7 +254,7 @@ TEST_CASE("get_board_index")
 	REQUIRE(index == 0);
 }
 
-TEST_CASE("normalize_range")
+TEST_CASE("normalize_range", "[leduc]")
 {
 	card_tools cardTools;
 
@@ -169,4 +268,77 @@ TEST_CASE("normalize_range")
 	ArrayX resultRange = cardTools.normalize_range(board2, uniformRange);
 	REQUIRE(resultRange.sum() == 1.0);
 	REQUIRE(resultRange(3) == 0.0);
-}
\ No newline at end of file
+}
+TEST_CASE("card_set")
+{
+	ArrayX board(1);
+	board << 4;
+	CardSet board_cards(board);
+
+	REQUIRE(board_cards.size() == 1);
+	REQUIRE(board_cards.contains(4));
+	REQUIRE(!board_cards.contains(5));
+	REQUIRE(board_cards.board_index() == 4);
+	REQUIRE((board_cards.to_array() == board).all());
+
+	CardSet hand = board_cards;
+	REQUIRE(!hand.add(4));
+	REQUIRE(hand.add(1));
+	REQUIRE(hand.size() == 2);
+	REQUIRE(hand.overlaps(board_cards));
+	REQUIRE(hand != board_cards);
+
+	CardSet other;
+	other.add(0);
+	REQUIRE(!other.overlaps(board_cards));
+
+	//--two card boards are indexed in the order of their lower card, then of their higher card
+	int index = 0;
+	for (int low = 0; low < card_count; low++)
+	{
+		for (int high = low + 1; high < card_count; high++)
+		{
+			CardSet pair;
+			pair.add(high);
+			pair.add(low);
+			REQUIRE(pair.board_index() == index);
+			index++;
+		}
+	}
+}
+
+TEST_CASE("board_tables", "[leduc]")
+{
+	card_tools cardTools;
+	card_tools otherTools;
+
+	ArrayX board(1);
+	board << 3;
+
+	//--the tables are shared, so every call returns the same vector
+	REQUIRE(&cardTools.get_possible_hand_indexes(board) == &otherTools.get_possible_hand_indexes(board));
+	REQUIRE(&cardTools.get_uniform_range(board) == &cardTools.get_uniform_range(board));
+
+	for (int card = 0; card < card_count; card++)
+	{
+		REQUIRE(cardTools.get_possible_hand_indexes(board)(card) == (card == 3 ? 0 : 1));
+		REQUIRE(cardTools.get_impossible_hand_indexes(board)(card) == (card == 3 ? 1 : 0));
+		REQUIRE(cardTools.get_uniform_range(board)(card) == Approx(card == 3 ? 0 : 1.0f / (card_count - 1)));
+	}
+
+	REQUIRE(cardTools.get_possible_hand_indexes(ArrayX()).sum() == card_count);
+
+	//--the compact hand space keeps the possible hands in card order
+	const vector<int>& hands = cardTools.get_possible_hands(CardSet(board));
+	const HandColumns& columns = cardTools.get_hand_columns(CardSet(board));
+	REQUIRE(hands.size() == card_count - 1);
+	REQUIRE(columns[3] == -1);
+
+	for (size_t column = 0; column < hands.size(); column++)
+	{
+		REQUIRE(hands[column] == (int)column + (column >= 3 ? 1 : 0));
+		REQUIRE(columns[hands[column]] == (int)column);
+	}
+
+	REQUIRE(cardTools.get_possible_hands(CardSet()).size() == card_count);
+}
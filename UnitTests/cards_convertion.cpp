@@ -65,4 +65,19 @@ TEST_CASE("string_to_board")
 	card_to_string_conversion converter;
 	ArrayX result = converter.string_to_board("Qs");
 	REQUIRE(result(0) == 4);
-}
\ No newline at end of file
+}
+TEST_CASE("game_context")
+{
+	static_assert(GameContext::card_to_rank(5) == 2 && GameContext::card_to_suit(5) == 1, "the card tables are computed at compile time");
+	static_assert(GameContext::rank_name(0) == 'A' && GameContext::suit_name(1) == 'h', "the card tables are computed at compile time");
+
+	//--the names are shared by all the converters
+	REQUIRE(GameContext::card_names().size() == card_count);
+	REQUIRE(GameContext::card_names().at(0) == "As");
+	REQUIRE(GameContext::card_names().at(5) == "Qh");
+
+	for (int card = 0; card < card_count; card++)
+	{
+		REQUIRE(GameContext::card_numbers().at(GameContext::card_names().at(card)) == card);
+	}
+}
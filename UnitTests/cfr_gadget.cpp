@@ -14,7 +14,7 @@ using namespace std;
 const float myEps = 0.001f;
 
 
-TEST_CASE("cfr_gadget_Ks_2_iter")
+TEST_CASE("cfr_gadget_Ks_2_iter", "[leduc]")
 {
 	card_to_string_conversion converter;
 	card_tools tools;
@@ -51,7 +51,7 @@ TEST_CASE("cfr_gadget_Ks_2_iter")
 	REQUIRE(op_range(5) == Approx(0.0).epsilon(myEps));
 }
 
-TEST_CASE("cfr_gadget_root_3_iter")
+TEST_CASE("cfr_gadget_root_3_iter", "[leduc]")
 {
 	card_to_string_conversion converter;
 	card_tools tools;
@@ -0,0 +1,189 @@
+#include "catch.hpp"
+#include "data_generation.h"
+#include "arguments.h"
+#include "TrainingData.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <fstream>
+
+TEST_CASE("generate_workers_count")
+{
+	const size_t data_count = 3 * gen_batch_size;
+	data_generation generator;
+
+	//--the situations are sampled in the order of the batches, so any number of workers gives the same examples
+	ArrayXX inputs, targets, mask;
+	srand(42);
+	generator.generate(data_count, 1, inputs, targets, mask);
+
+	ArrayXX parallelInputs, parallelTargets, parallelMask;
+	srand(42);
+	generator.generate(data_count, 3, parallelInputs, parallelTargets, parallelMask);
+
+	REQUIRE(inputs.rows() == data_count);
+	REQUIRE(targets.rows() == data_count);
+	REQUIRE(mask.rows() == data_count);
+	REQUIRE((inputs == parallelInputs).all());
+	REQUIRE((targets == parallelTargets).all());
+	REQUIRE((mask == parallelMask).all());
+
+	//--the pot feature is between ante / stack and 1, and the ranges of both players sum to one
+	const Index bucket_count = mask.cols();
+	REQUIRE((inputs.col(2 * bucket_count) >= (float)ante / stack).all());
+	REQUIRE((inputs.col(2 * bucket_count) <= 1).all());
+	REQUIRE(((inputs.leftCols(bucket_count).rowwise().sum() - 1).abs() < 0.001f).all());
+	REQUIRE(((inputs.middleCols(bucket_count, bucket_count).rowwise().sum() - 1).abs() < 0.001f).all());
+}
+
+TEST_CASE("training_data_file")
+{
+	const string path = "training_data_test.data";
+	remove(path.c_str());
+
+	TrainingDataLayout layout;
+	layout.bucket_count = 3;
+	layout.input_size = 7;
+	layout.target_size = 6;
+	layout.mask_size = 3;
+	layout.chunk_rows = 2;
+
+	srand(7);
+	ArrayXX inputs = ArrayXX::Random(6, layout.input_size);
+	ArrayXX targets = ArrayXX::Random(6, layout.target_size);
+	ArrayXX mask = ArrayXX::Random(6, layout.mask_size);
+
+	{
+		TrainingDataWriter writer;
+		REQUIRE(writer.open(path, layout));
+		REQUIRE(writer.append(inputs.topRows(4), targets.topRows(4), mask.topRows(4)));
+		REQUIRE(writer.rows() == 4);
+	}
+
+	//--a torn chunk after the committed ones is not read, and is cut off by the next writer
+	{
+		std::ofstream out(path, ios::out | ios::binary | ios::app);
+		const vector<char> torn(100, 1);
+		out.write(torn.data(), torn.size());
+	}
+
+	TrainingDataReader reader;
+	REQUIRE(reader.open(path));
+	REQUIRE(reader.rows() == 4);
+	reader.close();
+
+	{
+		TrainingDataWriter writer;
+		REQUIRE(writer.open(path, layout));
+		REQUIRE(writer.rows() == 4);
+		REQUIRE(writer.append(inputs.bottomRows(2), targets.bottomRows(2), mask.bottomRows(2)));
+
+		//--the examples of another layout are not mixed in
+		TrainingDataLayout other = layout;
+		other.chunk_rows = 3;
+		TrainingDataWriter otherWriter;
+		REQUIRE(!otherWriter.open(path, other));
+	}
+
+	REQUIRE(reader.open(path));
+	REQUIRE(reader.layout() == layout);
+	REQUIRE(reader.rows() == 6);
+
+	ArrayXX readInputs, readTargets, readMask;
+	reader.read({ 0, 1, 2, 3, 4, 5 }, readInputs, readTargets, readMask);
+	REQUIRE((readInputs == inputs).all());
+	REQUIRE((readTargets == targets).all());
+	REQUIRE((readMask == mask).all());
+
+	reader.read({ 5, 2 }, readInputs, readTargets, readMask);
+	REQUIRE((readInputs.row(0) == inputs.row(5)).all());
+	REQUIRE((readTargets.row(1) == targets.row(2)).all());
+	REQUIRE(reader.mask(3)[1] == mask(3, 1));
+}
+
+TEST_CASE("generate_data_file")
+{
+	const size_t data_count = 2 * gen_batch_size;
+	const string file_name = "generate_data_test";
+	remove((file_name + ".data").c_str());
+	data_generation generator;
+
+	ArrayXX inputs, targets, mask;
+	srand(42);
+	generator.generate(data_count, 1, inputs, targets, mask);
+
+	//--a second call appends to the file
+	srand(42);
+	generator.generate_data_file(data_count, file_name, 2);
+	generator.generate_data_file(data_count, file_name, 2);
+
+	TrainingDataReader reader;
+	REQUIRE(reader.open(file_name + ".data"));
+	REQUIRE(reader.rows() == 2 * data_count);
+	REQUIRE(reader.layout().bucket_count == mask.cols());
+
+	vector<size_t> rows;
+	for (size_t row = 0; row < data_count; row++)
+	{
+		rows.push_back(row);
+	}
+
+	ArrayXX readInputs, readTargets, readMask;
+	reader.read(rows, readInputs, readTargets, readMask);
+	REQUIRE((readInputs == inputs).all());
+	REQUIRE((readTargets == targets).all());
+	REQUIRE((readMask == mask).all());
+}
+
+TEST_CASE("export_npy")
+{
+	const string path = "export_npy_test.data";
+	remove(path.c_str());
+
+	TrainingDataLayout layout;
+	layout.bucket_count = 2;
+	layout.input_size = 5;
+	layout.target_size = 4;
+	layout.mask_size = 2;
+	layout.chunk_rows = 3;
+
+	srand(7);
+	ArrayXX inputs = ArrayXX::Random(6, layout.input_size);
+	ArrayXX targets = ArrayXX::Random(6, layout.target_size);
+	ArrayXX mask = ArrayXX::Random(6, layout.mask_size);
+
+	{
+		TrainingDataWriter writer;
+		REQUIRE(writer.open(path, layout));
+		REQUIRE(writer.append(inputs, targets, mask));
+	}
+
+	TrainingDataReader reader;
+	REQUIRE(reader.open(path));
+	REQUIRE(reader.export_npy("export_npy_test"));
+
+	const string names[] = { ".inputs.npy", ".targets.npy", ".mask.npy" };
+	const ArrayXX* arrays[] = { &inputs, &targets, &mask };
+
+	for (int array = 0; array < 3; array++)
+	{
+		std::ifstream in("export_npy_test" + names[array], ios::in | ios::binary);
+		const string file((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+		//--version 1.0, the data starts on a 64 byte boundary after a newline ended header
+		REQUIRE(file.compare(0, 8, string("\x93NUMPY\x01\x00", 8)) == 0);
+		const size_t header_size = (unsigned char)file[8] | ((unsigned char)file[9] << 8);
+		const size_t data_start = 10 + header_size;
+		REQUIRE(data_start % 64 == 0);
+		REQUIRE(file[data_start - 1] == '\n');
+
+		const string shape = "'shape': (6, " + std::to_string(arrays[array]->cols()) + ")";
+		REQUIRE(file.find("'descr': '<f4'") < data_start);
+		REQUIRE(file.find("'fortran_order': False") < data_start);
+		REQUIRE(file.find(shape) < data_start);
+
+		//--the data is row-major, as the arrays
+		REQUIRE(file.size() == data_start + arrays[array]->size() * sizeof(float));
+		Eigen::Map<const ArrayXX> data((const float*)(file.data() + data_start), 6, arrays[array]->cols());
+		REQUIRE((data == *arrays[array]).all());
+	}
+}
@@ -60,7 +60,7 @@ ArrayX GetBatchEvalVector(string boardCard)
 	return res;
 }
 
-TEST_CASE("batch_eval_As")
+TEST_CASE("batch_eval_As", "[leduc]")
 {
 	card_to_string_conversion converter;
 	ArrayX batch = GetBatchEvalVector("As");
@@ -71,7 +71,7 @@ TEST_CASE("batch_eval_As")
 	REQUIRE(batch(converter.string_to_card("As")) == INVALID_HAND_VALUE);
 }
 
-TEST_CASE("batch_eval_Qs")
+TEST_CASE("batch_eval_Qs", "[leduc]")
 {
 	card_to_string_conversion converter;
 	ArrayX batch = GetBatchEvalVector("Qs");
@@ -79,4 +79,24 @@ TEST_CASE("batch_eval_Qs")
 	REQUIRE(batch(converter.string_to_card("Ah")) < batch(converter.string_to_card("Kh")));
 	REQUIRE(batch(converter.string_to_card("Qh")) < batch(converter.string_to_card("Ah"))); // We will have a pair with Qh. So it is more important than ace.
 	REQUIRE(batch(converter.string_to_card("Qs")) == INVALID_HAND_VALUE);
-}
\ No newline at end of file
+}
+TEST_CASE("batch_eval_matches_evaluate", "[leduc]")
+{
+	LeducEvaluator evaluator;
+	ArrayX invalid(1);
+	invalid << INVALID_HAND_VALUE;
+
+	for (int board_card = 0; board_card < card_count; board_card++)
+	{
+		ArrayX board(1);
+		board << (float)board_card;
+		ArrayX batch = evaluator.batch_eval(board, invalid);
+
+		for (int card = 0; card < card_count; card++)
+		{
+			ArrayX hand(2);
+			hand << (float)board_card, (float)card;
+			REQUIRE(batch(card) == evaluator.evaluate(hand, invalid)(0));
+		}
+	}
+}
@@ -14,7 +14,7 @@ using namespace std;
 
 const float myEps = 0.05f;
 
-TEST_CASE("range_gen_empty_board")
+TEST_CASE("range_gen_empty_board", "[leduc]")
 {
 	card_to_string_conversion converter;
 	card_tools tools;
@@ -50,7 +50,7 @@ TEST_CASE("range_gen_empty_board")
 	REQUIRE(bSum(5) == Approx(0.19).epsilon(myEps));
 }
 
-TEST_CASE("range_gen_Qs")
+TEST_CASE("range_gen_Qs", "[leduc]")
 {
 	card_to_string_conversion converter;
 	card_tools tools;
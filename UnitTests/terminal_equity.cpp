@@ -14,7 +14,7 @@ float GetMatrixVal(string me, string other, ArrayXX matrix)
 	return res;
 }
 
-TEST_CASE("get_last_round_call_matrix")
+TEST_CASE("get_last_round_call_matrix", "[leduc]")
 {
 	card_to_string_conversion converter;
 	int card = converter.string_to_card("Ah");
@@ -53,14 +53,16 @@ TEST_CASE("get_last_round_call_matrix")
 	REQUIRE(GetMatrixVal("Kh", "Qh", callMatrix) == 1);
 }
 
-TEST_CASE("_fold_matrix")
+TEST_CASE("fold_value_blocking", "[leduc]")
 {
 	card_to_string_conversion converter;
 	ArrayX board = converter.string_to_board("Qs");
-	terminal_equity term;
+	terminal_equity term(board);
 
-	term._set_fold_matrix(board);
-	auto foldMatrix = term._fold_matrix;
+	//--the opponent holding one card per row gives the equity of every hand against it
+	ArrayXX opponentHands = MatrixX::Identity(card_count, card_count).array();
+	ArrayXX foldMatrix(card_count, card_count);
+	term.fold_value(opponentHands, foldMatrix);
 
 	REQUIRE(GetMatrixVal("As", "Ah", foldMatrix) == 1);
 	REQUIRE(GetMatrixVal("Ah", "As", foldMatrix) == 1);
@@ -85,7 +87,7 @@ TEST_CASE("_fold_matrix")
 	REQUIRE(GetMatrixVal("Qs", "As", foldMatrix) == 0);
 }
 
-TEST_CASE("_call_matrix")
+TEST_CASE("_call_matrix", "[leduc]")
 {
 	card_to_string_conversion converter;
 	ArrayX board = converter.string_to_board("");
@@ -120,7 +122,28 @@ TEST_CASE("_call_matrix")
 	REQUIRE(GetMatrixVal("Qs", "As", callMatrix) == -0.5);
 }
 
-TEST_CASE("call_matrix_with_board")
+TEST_CASE("_call_matrix_average")
+{
+	card_tools cardTools;
+	terminal_equity term;
+	ArrayXX expected = ArrayXX::Zero(card_count, card_count);
+	ArrayXX board_matrix;
+
+	//--the first round matrix is the average of the last round matrices over the boards that the hands do not block
+	ArrayXX boards = cardTools.get_second_round_boards();
+	for (int board = 0; board < boards.rows(); board++)
+	{
+		ArrayX cards = boards.row(board);
+		term.get_last_round_call_matrix(cards, board_matrix);
+		expected += board_matrix;
+	}
+
+	expected /= (float)cardTools.get_possible_boards_count();
+	REQUIRE(term.get_call_matrix().isApprox(expected, 0.00001f));
+	REQUIRE((term.get_call_matrix() + term.get_call_matrix().transpose()).abs().maxCoeff() == 0);
+}
+
+TEST_CASE("call_matrix_with_board", "[leduc]")
 {
 	card_to_string_conversion converter;
 	ArrayX board = converter.string_to_board("Qs");
@@ -136,7 +159,7 @@ TEST_CASE("call_matrix_with_board")
 	REQUIRE(GetMatrixVal("Qh", "Qs", callMatrix) == 0);
 }
 
-TEST_CASE("tree_node_call_value")
+TEST_CASE("tree_node_call_value", "[leduc]")
 {
 	ArrayXX range(2, 6);
 	int i = 0;
@@ -161,7 +184,7 @@ TEST_CASE("tree_node_call_value")
 }
 
 #include "Util.h"
-TEST_CASE("tree_node_fold_value")
+TEST_CASE("tree_node_fold_value", "[leduc]")
 {
 	// Create a tensor of 2 dimensions
 	//Eigen::Tensor<int, 2> a(2, 3);
@@ -209,7 +232,7 @@ TEST_CASE("tree_node_fold_value")
 	REQUIRE(result(1, 4) == Approx(-1.1250).epsilon(myEps));
 }
 
-TEST_CASE("tree_node_fold_value_integration")
+TEST_CASE("tree_node_fold_value_integration", "[leduc]")
 {
 	ArrayXX range(2, 6);
 
@@ -238,4 +261,225 @@ TEST_CASE("tree_node_fold_value_integration")
 	REQUIRE(result(1, 3) == Approx(-0.8).epsilon(myEps));
 	REQUIRE(result(1, 4) == Approx(-0.8).epsilon(myEps));
 	REQUIRE(result(1, 5) == Approx(-0.8).epsilon(myEps));
-}
\ No newline at end of file
+}
+#include "TerminalEquityRegistry.h"
+TEST_CASE("terminal_equity_registry", "[leduc]")
+{
+	card_to_string_conversion converter;
+	ArrayX board = converter.string_to_board("As");
+	ArrayX sameBoard = converter.string_to_board("As");
+	ArrayX otherBoard = converter.string_to_board("Kh");
+	ArrayX emptyBoard = converter.string_to_board("");
+
+	TerminalEquityRegistry& registry = TerminalEquityRegistry::instance();
+	const terminal_equity& equity = registry.get(board);
+
+	// One evaluator per board, shared by every caller
+	REQUIRE(&equity == &registry.get(sameBoard));
+	REQUIRE(&equity == &TerminalEquityRegistry::instance().get(board));
+	REQUIRE(&equity != &registry.get(otherBoard));
+	REQUIRE(&registry.get(emptyBoard) != &equity);
+
+	terminal_equity term;
+	term.set_board(board);
+	REQUIRE((equity.get_call_matrix() == term.get_call_matrix()).all());
+	REQUIRE((equity._possible_hands == term._possible_hands).all());
+
+	terminal_equity emptyTerm;
+	REQUIRE((registry.get(emptyBoard).get_call_matrix() == emptyTerm.get_call_matrix()).all());
+}
+
+TEST_CASE("sorted_call_value", "[leduc]")
+{
+	card_to_string_conversion converter;
+	srand(7);
+
+	for (int card = 0; card < card_count; card++)
+	{
+		ArrayX board(1);
+		board << (float)card;
+		terminal_equity term(board);
+
+		ArrayXX ranges = (ArrayXX::Random(3, card_count) + 1) / 2;
+		ArrayXX expected = (ranges.matrix() * term.get_call_matrix().matrix()).array();
+		ArrayXX result(3, card_count);
+		term.sorted_call_value(ranges, result);
+
+		//--the blocked hands get no value
+		REQUIRE(result.col(card).isZero());
+		REQUIRE(result.isApprox(expected, 0.00001f));
+	}
+
+	//--the first round averages over the boards, it has no order
+	terminal_equity first_round;
+	REQUIRE(first_round._strength_order.empty());
+}
+
+TEST_CASE("fold_value", "[leduc]")
+{
+	srand(7);
+
+	//--the first round board and every last round board
+	for (int card = -1; card < card_count; card++)
+	{
+		ArrayX board(card < 0 ? 0 : 1);
+		if (card >= 0)
+		{
+			board << (float)card;
+		}
+
+		terminal_equity term(board);
+
+		//--the ones minus identity matrix with the rows and the columns of the blocked hands zeroed
+		ArrayXX possibleHands = term._cardTools.get_possible_hand_indexes(board);
+		MatrixX foldMatrix = (MatrixX::Ones(card_count, card_count) - MatrixX::Identity(card_count, card_count)).array() * (possibleHands.matrix() * possibleHands.matrix().transpose()).array();
+
+		ArrayXX ranges = (ArrayXX::Random(3, card_count) + 1) / 2;
+		ArrayXX expected = (ranges.matrix() * foldMatrix).array();
+		ArrayXX result(3, card_count);
+		term.fold_value(ranges, result);
+
+		REQUIRE(result.isApprox(expected, 0.00001f));
+	}
+}
+
+TEST_CASE("compact_values", "[leduc]")
+{
+	card_tools cardTools;
+	srand(7);
+
+	//--the first round board and every last round board
+	for (int card = -1; card < card_count; card++)
+	{
+		ArrayX board(card < 0 ? 0 : 1);
+		if (card >= 0)
+		{
+			board << (float)card;
+		}
+
+		terminal_equity term(board);
+		const vector<int>& hands = cardTools.get_possible_hands(CardSet(board));
+		const int width = (int)hands.size();
+
+		ArrayXX ranges = (ArrayXX::Random(2, card_count) + 1) / 2;
+		ranges.rowwise() *= cardTools.get_possible_hand_indexes(board).transpose();
+
+		ArrayXX call_expected(2, card_count);
+		ArrayXX fold_expected(2, card_count);
+		term.tree_node_call_value(ranges, call_expected);
+		term.tree_node_fold_value(ranges, fold_expected, P1);
+
+		ArrayXX compact_buffer(2, width);
+		ArrayXX call_buffer(2, width);
+		ArrayXX fold_buffer(2, width);
+		AmAxx compact_ranges(compact_buffer.data(), 2, width);
+		AmAxx call_result(call_buffer.data(), 2, width);
+		AmAxx fold_result(fold_buffer.data(), 2, width);
+
+		for (int column = 0; column < width; column++)
+		{
+			compact_ranges.col(column) = ranges.col(hands[column]);
+		}
+
+		term.tree_node_compact_call_value(compact_ranges, call_result);
+		term.tree_node_compact_fold_value(compact_ranges, fold_result, P1);
+
+		//--the possible hands get the same values, in the order of the compact hand space
+		for (int column = 0; column < width; column++)
+		{
+			REQUIRE(call_result.col(column).isApprox(call_expected.col(hands[column]), 0.00001f));
+			REQUIRE(fold_result.col(column).isApprox(fold_expected.col(hands[column]), 0.00001f));
+		}
+	}
+}
+
+#include "EquityStore.h"
+#include <fstream>
+TEST_CASE("equity_store")
+{
+	card_tools cardTools;
+	ArrayXX boards = cardTools.get_second_round_boards();
+	srand(7);
+	ArrayXX ranges = (ArrayXX::Random(2, card_count) + 1) / 2;
+
+	for (bool dense : { true, false })
+	{
+		const string path = "equity_store_test.bin";
+		REQUIRE(EquityStore::write(path, dense));
+
+		EquityStore store;
+		REQUIRE(store.open(path));
+
+		//--the empty board, then every last round board
+		for (int slot = 0; slot <= boards.rows(); slot++)
+		{
+			ArrayX board = slot == 0 ? ArrayX() : ArrayX(boards.row(slot - 1));
+			terminal_equity computed(board);
+
+			EquityStore::BoardData data;
+			REQUIRE(store.find(CardSet(board), data));
+			REQUIRE((data.call_matrix != nullptr) == (dense || slot == 0));
+			terminal_equity loaded(board, data);
+
+			//--the sorted form gives the same call matrix and the same values
+			REQUIRE((loaded.get_call_matrix() == computed.get_call_matrix()).all());
+			REQUIRE(loaded._strength_order == computed._strength_order);
+			REQUIRE(loaded._compact_strength_order == computed._compact_strength_order);
+
+			ArrayXX expected(2, card_count);
+			ArrayXX result(2, card_count);
+			computed.tree_node_call_value(ranges, expected);
+			loaded.tree_node_call_value(ranges, result);
+			REQUIRE((result == expected).all());
+
+			computed.tree_node_fold_value(ranges, expected, P1);
+			loaded.tree_node_fold_value(ranges, result, P1);
+			REQUIRE((result == expected).all());
+		}
+
+		store.close();
+		REQUIRE(!store.is_open());
+	}
+
+	//--a file of a deck with the same number of cards split in other ranks and suits is not used
+	{
+		REQUIRE(EquityStore::write("equity_store_test.bin"));
+		fstream file("equity_store_test.bin", ios::in | ios::out | ios::binary);
+		const uint32_t ranks = rank_count + 1;
+		file.seekp(16);
+		file.write((const char*)&ranks, sizeof(uint32_t));
+	}
+
+	{
+		EquityStore store;
+		REQUIRE(!store.open("equity_store_test.bin"));
+	}
+
+	//--a file whose call matrix runs past its end is not used
+	{
+		REQUIRE(EquityStore::write("equity_store_test.bin"));
+		fstream file("equity_store_test.bin", ios::in | ios::out | ios::binary);
+		file.seekg(0, ios::end);
+		const uint64_t offset = (uint64_t)file.tellg() - sizeof(float);
+
+		//--the call matrix offset of the empty board, the first entry after the 32 byte header
+		file.seekp(32 + 8);
+		file.write((const char*)&offset, sizeof(uint64_t));
+	}
+
+	{
+		EquityStore store;
+		REQUIRE(!store.open("equity_store_test.bin"));
+	}
+
+	//--a file of another layout is not used
+	{
+		ofstream out("equity_store_test.bin", ios::out | ios::binary | ios::trunc);
+		out << "not an equity store";
+	}
+
+	EquityStore store;
+	REQUIRE(!store.open("equity_store_test.bin"));
+	REQUIRE(!store.open("missing_equity_store_test.bin"));
+	remove("equity_store_test.bin");
+}
@@ -1,5 +1,6 @@
 #include "catch.hpp"
 #include "tree_builder.h"
+#include "card_tools.h"
 #include "Node.h"
 #include "card_to_string_conversion.h"
 #include <string>
@@ -21,7 +22,7 @@ TEST_CASE("_get_children_nodes_transition_call")
 	delete(newNode);
 }
 
-TEST_CASE("_get_children_nodes_chance_node")
+TEST_CASE("_get_children_nodes_chance_node", "[leduc]")
 {
 	card_to_string_conversion converter;
 	Node root_node;
@@ -36,6 +37,37 @@ TEST_CASE("_get_children_nodes_chance_node")
 	REQUIRE(result.size() == 6);
 }
 
+TEST_CASE("_get_children_nodes_chance_node_suit_isomorphism")
+{
+	card_to_string_conversion converter;
+	Node root_node;
+	root_node.board = converter.string_to_board("");
+	root_node.street = 1;
+	root_node.current_player = chance;
+	root_node.bets << 100, 100;
+
+	tree_builder builder;
+	builder._suit_isomorphism = true;
+	vector<Node*> result = builder._get_children_nodes_chance_node(root_node);
+
+	//--a child per class of suit-isomorphic boards, carrying the permutations of its class
+	card_tools cardTools;
+	vector<vector<CardPermutation>> board_permutations;
+	cardTools.get_canonical_second_round_boards(board_permutations);
+	REQUIRE(result.size() == board_permutations.size());
+
+	if (board_card_count == 1)
+	{
+		REQUIRE(result.size() == 3);
+	}
+
+	for (size_t child = 0; child < result.size(); child++)
+	{
+		REQUIRE(result[child]->suit_permutations.size() == board_permutations[child].size());
+		delete(result[child]);
+	}
+}
+
 TEST_CASE("_get_children_player_node")
 {
 	card_to_string_conversion converter;
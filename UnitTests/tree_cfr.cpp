@@ -6,6 +6,7 @@
 //#include "tree_builder.h"
 //#include "card_tools.h"
 //#include "TreeCFR.h"
+#include "Resolving.h"
 //#include "Util.h"
 //
 //#include <string>
@@ -288,4 +289,329 @@
 //
 //	REQUIRE(tree.strategy(1, 2) == Approx(0.5030f).epsilon(myEps));
 //	REQUIRE(tree.strategy(2, 4) == Approx(0.1426).epsilon(myEps));
-//}
\ No newline at end of file
+//}
+
+#include "catch.hpp"
+#include "Node.h"
+#include "card_to_string_conversion.h"
+#include "TreeBuilderParams.h"
+#include "tree_builder.h"
+#include "tree_values.h"
+#include "card_tools.h"
+#include "TreeCFR.h"
+
+#include <algorithm>
+#include <limits>
+
+static Node* build_leduc_tree(ArrayXX& starting_ranges, bool suit_isomorphism = false, const VectorX& bet_sizing = VectorX())
+{
+	TreeBuilderParams params;
+	params.suit_isomorphism = suit_isomorphism;
+	params.bet_sizing = bet_sizing;
+	Node node;
+	params.root_node = &node;
+	card_to_string_conversion converter;
+	params.root_node->board = converter.string_to_board("");
+	params.root_node->street = 1;
+	params.root_node->current_player = P1;
+	params.root_node->bets << 100, 100;
+
+	tree_builder builder;
+	Node* tree = builder.build_tree(params);
+	card_tools cradTools;
+
+	starting_ranges.resize(players_count, card_count);
+	starting_ranges.row(0) = cradTools.get_uniform_range(params.root_node->board);
+	starting_ranges.row(1) = cradTools.get_uniform_range(params.root_node->board);
+	return tree;
+}
+
+static Node* solve_leduc_tree(cfr_modes mode, size_t iter_count, size_t skip_iters, int threads_count, ArrayXX& starting_ranges)
+{
+	Node* tree = build_leduc_tree(starting_ranges);
+	TreeCFR tree_cfr(mode);
+	tree_cfr.run_cfr(*tree, starting_ranges, iter_count, skip_iters, threads_count);
+	return tree;
+}
+
+static float solve_leduc(cfr_modes mode, size_t iter_count, size_t skip_iters)
+{
+	ArrayXX starting_ranges;
+	Node* tree = solve_leduc_tree(mode, iter_count, skip_iters, 1, starting_ranges);
+
+	tree_values tv;
+	tv.compute_values(*tree, &starting_ranges);
+	return tree->exploitability;
+}
+
+TEST_CASE("tree_cfr_plus_exploitability", "[leduc]")
+{
+	const float vanilla = solve_leduc(cfr_vanilla, 1000, 300);
+	const float plus = solve_leduc(cfr_plus, 1000, 0);
+
+	REQUIRE(plus >= 0);
+	REQUIRE(plus < 0.5f);
+	REQUIRE(plus < vanilla / 10);
+}
+
+static void require_same_strategies(Node& first, Node& second)
+{
+	REQUIRE((first.strategy == second.strategy).all());
+	REQUIRE((first.cf_values == second.cf_values).all());
+	REQUIRE(first.children.size() == second.children.size());
+
+	for (size_t child = 0; child < first.children.size(); child++)
+	{
+		require_same_strategies(*first.children[child], *second.children[child]);
+	}
+}
+
+TEST_CASE("tree_cfr_threads_deterministic")
+{
+	ArrayXX starting_ranges;
+	Node* serial = solve_leduc_tree(cfr_plus, 50, 0, 1, starting_ranges);
+	Node* parallel = solve_leduc_tree(cfr_plus, 50, 0, 4, starting_ranges);
+
+	require_same_strategies(*serial, *parallel);
+}
+
+TEST_CASE("tree_cfr_target_exploitability")
+{
+	ArrayXX starting_ranges;
+	Node* tree = build_leduc_tree(starting_ranges);
+
+	TreeCFR tree_cfr(cfr_plus);
+	tree_cfr.set_target_exploitability(1.0f, exploitability_chips, 50);
+	tree_cfr.run_cfr(*tree, starting_ranges, 2000, 0);
+
+	//--CFR+ gets under a chip in a few hundred iterations
+	REQUIRE(tree_cfr.get_iterations_done() < 2000);
+	REQUIRE(tree_cfr.get_iterations_done() % 50 == 0);
+	REQUIRE(tree_cfr.get_exploitability() >= 0);
+	REQUIRE(tree_cfr.get_exploitability() < 1.0f);
+
+	//--the check measures the strategy that is saved in the tree
+	tree_values tv;
+	tv.compute_values(*tree, &starting_ranges);
+	REQUIRE(tree->exploitability == Approx(tree_cfr.get_exploitability()).epsilon(0.001));
+
+	//--the same target in mbb/hand
+	REQUIRE(tree_values::to_units(1.0f, exploitability_mbb) == Approx(1000.0f / ante));
+}
+
+static int count_nodes(Node& node)
+{
+	int count = 1;
+	for (Node* child : node.children)
+	{
+		count += count_nodes(*child);
+	}
+
+	return count;
+}
+
+TEST_CASE("tree_cfr_suit_isomorphism")
+{
+	ArrayXX starting_ranges;
+	Node* full = build_leduc_tree(starting_ranges);
+	Node* isomorphic = build_leduc_tree(starting_ranges, true);
+
+	//--the second street subtrees are shared by the suits
+	REQUIRE(count_nodes(*isomorphic) < count_nodes(*full) * 6 / 10);
+
+	TreeCFR full_cfr(cfr_plus);
+	full_cfr.run_cfr(*full, starting_ranges, 300, 0);
+	TreeCFR isomorphic_cfr(cfr_plus);
+	isomorphic_cfr.run_cfr(*isomorphic, starting_ranges, 300, 0);
+
+	//--the first street is solved the same, up to the rounding of the sums in another order,
+	//-- which drifts further on the boards of two cards
+	const float precision = board_card_count == 1 ? 0.001f : 0.005f;
+	REQUIRE(isomorphic->strategy.isApprox(full->strategy, precision));
+	REQUIRE(isomorphic->children[1]->strategy.isApprox(full->children[1]->strategy, precision));
+
+	tree_values tv;
+	tv.compute_values(*full, &starting_ranges);
+	tv.compute_values(*isomorphic, &starting_ranges);
+	REQUIRE(isomorphic->exploitability == Approx(full->exploitability).epsilon(precision));
+	REQUIRE(isomorphic->cf_values.isApprox(full->cf_values, precision));
+}
+
+TEST_CASE("tree_values_suit_isomorphism_ranges")
+{
+	ArrayXX uniform;
+	Node* full = build_leduc_tree(uniform);
+	Node* isomorphic = build_leduc_tree(uniform, true);
+
+	TreeCFR full_cfr(cfr_plus);
+	full_cfr.run_cfr(*full, uniform, 300, 0);
+	TreeCFR isomorphic_cfr(cfr_plus);
+	isomorphic_cfr.run_cfr(*isomorphic, uniform, 300, 0);
+
+	//--starting ranges that depend on the ranks only, and ones that also depend on the suits
+	card_to_string_conversion converter;
+	ArrayXX rank_ranges(players_count, card_count);
+	ArrayXX suit_ranges(players_count, card_count);
+
+	for (int card = 0; card < card_count; card++)
+	{
+		const int rank = converter.card_to_rank(card);
+		const int suit = converter.card_to_suit(card);
+		rank_ranges(P1, card) = 1.0f + rank;
+		rank_ranges(P2, card) = (float)(rank_count - rank);
+		suit_ranges(P1, card) = 1.0f + rank + 2 * suit;
+		suit_ranges(P2, card) = (float)(rank_count - rank + suit);
+	}
+
+	rank_ranges.colwise() /= rank_ranges.rowwise().sum();
+	suit_ranges.colwise() /= suit_ranges.rowwise().sum();
+
+	//--the shared subtrees give the values of the full tree whenever the ranges do not depend on the suits
+	const float precision = board_card_count == 1 ? 0.001f : 0.005f;
+	tree_values tv;
+	tv.compute_values(*full, &rank_ranges);
+	tv.compute_values(*isomorphic, &rank_ranges);
+	REQUIRE(isomorphic->cf_values.isApprox(full->cf_values, precision));
+	REQUIRE(isomorphic->exploitability == Approx(full->exploitability).epsilon(precision));
+
+	//--check, check: the chance node is at the same place in both trees
+	Node* full_chance = full->children[1]->children[1];
+	Node* isomorphic_chance = isomorphic->children[1]->children[1];
+	REQUIRE(full_chance->current_player == chance);
+	REQUIRE(isomorphic_chance->current_player == chance);
+
+	FlatTree flat(*isomorphic, 1, true);
+	const int chance_node = (int)(find(flat.nodes.begin(), flat.nodes.end(), isomorphic_chance) - flat.nodes.begin());
+	REQUIRE(chance_node < flat.nodes_count);
+
+	//--the ranges that reach the chance node of the full tree from the starting ranges that depend on the suits
+	//-- are told apart, the shared subtrees cannot carry them
+	for (ArrayXX* starting_ranges : { &rank_ranges, &suit_ranges })
+	{
+		tv.compute_values(*full, starting_ranges);
+
+		for (int player = P1; player <= P2; player++)
+		{
+			flat.import_row(flat.ranges(player), chance_node, full_chance->ranges.row(player));
+			REQUIRE(flat.is_suit_symmetric(flat.ranges(player), chance_node) == (starting_ranges == &rank_ranges));
+		}
+	}
+}
+
+TEST_CASE("tree_cfr_regret_pruning")
+{
+	VectorX bet_sizing(3);
+	bet_sizing << 0.5f, 1.0f, 2.0f;
+	ArrayXX starting_ranges;
+	Node* pruned = build_leduc_tree(starting_ranges, false, bet_sizing);
+	Node* exact = build_leduc_tree(starting_ranges, false, bet_sizing);
+
+	TreeCFR pruned_cfr;
+	pruned_cfr.set_regret_pruning(true, 1);
+	pruned_cfr.run_cfr(*pruned, starting_ranges, 400, 100);
+
+	//--the same regret matching without skipping anything
+	TreeCFR exact_cfr;
+	exact_cfr.set_regret_pruning(true, numeric_limits<int>::max());
+	exact_cfr.run_cfr(*exact, starting_ranges, 400, 100);
+
+	REQUIRE(pruned_cfr.get_pruned_actions() > 0);
+	REQUIRE(exact_cfr.get_pruned_actions() == 0);
+
+	//--the skipped iterations are brought up to date exactly, up to the rounding
+	REQUIRE(pruned->strategy.isApprox(exact->strategy, 0.001f));
+	REQUIRE(pruned->children[1]->strategy.isApprox(exact->children[1]->strategy, 0.001f));
+
+	tree_values tv;
+	tv.compute_values(*pruned, &starting_ranges);
+	tv.compute_values(*exact, &starting_ranges);
+	REQUIRE(pruned->exploitability == Approx(exact->exploitability).epsilon(0.001));
+}
+
+TEST_CASE("tree_cfr_no_malloc")
+{
+	//--a forbidden allocation fails an Eigen assert, only such builds check anything
+#ifndef EIGEN_RUNTIME_NO_MALLOC
+	WARN("built without EIGEN_RUNTIME_NO_MALLOC, the allocations are not checked");
+#endif
+
+	for (cfr_modes mode : { cfr_vanilla, cfr_plus })
+	{
+		ArrayXX starting_ranges;
+		Node* tree = build_leduc_tree(starting_ranges);
+
+		TreeCFR tree_cfr(mode);
+		tree_cfr.set_allocation_check(true);
+		tree_cfr.set_regret_pruning(mode == cfr_vanilla, 1);
+		tree_cfr.run_cfr(*tree, starting_ranges, 200, 50, 2);
+
+		REQUIRE(tree_cfr.get_iterations_done() == 200);
+	}
+}
+
+TEST_CASE("flat_tree_compact")
+{
+	ArrayXX starting_ranges;
+	Node* tree = solve_leduc_tree(cfr_plus, 100, 0, 1, starting_ranges);
+
+	//--the second street rows keep the hands that the board does not block
+	FlatTree full(*tree);
+	FlatTree compact(*tree, 1, true);
+	REQUIRE(compact.width[0] == card_count);
+	REQUIRE(compact.width[compact.nodes_count - 1] == card_count - board_card_count);
+	REQUIRE(full.width[full.nodes_count - 1] == card_count);
+
+	//--the same strategy evaluated on every hand and on the possible hands
+	tree_values tv;
+	const float full_exploitability = tv.compute_exploitability(full, starting_ranges);
+	REQUIRE(tv.compute_exploitability(compact, starting_ranges) == Approx(full_exploitability).epsilon(0.0001));
+
+	//--the exported payloads are over every hand again
+	full.export_to_nodes();
+	vector<ArrayXX> ranges;
+	vector<ArrayXX> cf_values;
+
+	for (Node* node : full.nodes)
+	{
+		ranges.push_back(node->ranges);
+		cf_values.push_back(node->cf_values);
+	}
+
+	compact.export_to_nodes();
+
+	for (int node = 0; node < compact.nodes_count; node++)
+	{
+		REQUIRE((compact.nodes[node]->ranges - ranges[node]).abs().maxCoeff() < 0.00001f);
+		REQUIRE((compact.nodes[node]->cf_values - cf_values[node]).abs().maxCoeff() < 0.001f);
+	}
+}
+
+TEST_CASE("solve_and_resolve_game")
+{
+	//--the whole game, with boards of board_card_count cards, is built and solved from the root
+	const float early = solve_leduc(cfr_plus, 20, 0);
+	const float solved = solve_leduc(cfr_plus, 300, 0);
+	REQUIRE(solved >= 0);
+	REQUIRE(solved < early / 10);
+
+	//--then re-solved on the last board of the second street
+	card_tools tools;
+	ArrayXX boards = tools.get_second_round_boards();
+	Node node;
+	node.board = boards.row(boards.rows() - 1);
+	node.street = 2;
+	node.current_player = P1;
+	node.bets << 100, 100;
+
+	const CardArray range = tools.get_uniform_range(node.board);
+	const CardArray possible = tools.get_possible_hand_indexes(node.board);
+	Resolving resolver;
+	LookaheadResult result = resolver.resolve_first_node(node, range, range);
+
+	//--a strategy for every hand, uniform for the hands that the board blocks, and finite values, none for the blocked hands
+	REQUIRE(result.strategy.rows() == resolver.get_possible_actions().size());
+	REQUIRE(((result.strategy.colwise().sum() - 1).abs() < 0.001f).all());
+	REQUIRE(result.root_cfvs.allFinite());
+	REQUIRE(result.achieved_cfvs.allFinite());
+	REQUIRE((result.root_cfvs * (1 - possible)).abs().maxCoeff() == 0);
+}
@@ -60,7 +60,7 @@ TreeLookahed* BuildLook(Resolving& resolver)
 }
 
 
-TEST_CASE("tree_lookahed_set_opponent_starting_range")
+TEST_CASE("tree_lookahed_set_opponent_starting_range", "[leduc]")
 {
 	Resolving resolver;
 	TreeLookahed* look = BuildLook(resolver);
@@ -75,7 +75,7 @@ TEST_CASE("tree_lookahed_set_opponent_starting_range")
 	AreEq(plRrange, plTarget);
 }
 
-TEST_CASE("tree_lookahed_full_cycle_P2")
+TEST_CASE("tree_lookahed_full_cycle_P2", "[leduc]")
 {
 	Resolving resolver;
 	Node node;
@@ -142,7 +142,7 @@ TEST_CASE("tree_lookahed_full_cycle_P2")
 	AreEq(chStr3, children_cfvs3);
 }
 
-TEST_CASE("tree_lookahed_full_cycle_P1")
+TEST_CASE("tree_lookahed_full_cycle_P1", "[leduc]")
 {
 	Resolving resolver;
 	Node node;
@@ -210,3 +210,323 @@ TEST_CASE("tree_lookahed_full_cycle_P1")
 }
 
 
+
+LookaheadResult ResolveKs(bool discounting, long long skip_iters, long long iters)
+{
+	Resolving resolver;
+	Node node;
+	card_to_string_conversion converter;
+	node.board = converter.string_to_board("Ks");
+	node.street = 2;
+	node.current_player = P1;
+	node.bets << 100, 100;
+
+	card_tools tools;
+	Range player_range = tools.get_uniform_range(node.board);
+	Range op_cfvs(card_count);
+	op_cfvs << -50, 0, 70, -90, 80, 120;
+
+	resolver._create_lookahead_tree(node);
+	TreeLookahed look(*resolver._lookahead_tree, skip_iters, iters);
+	look._discounting = discounting;
+	look.resolve(player_range, op_cfvs);
+	return look.get_results();
+}
+
+TEST_CASE("tree_lookahed_discounting", "[leduc]")
+{
+	LookaheadResult reference = ResolveKs(false, 1000, 2000);
+	LookaheadResult result = ResolveKs(true, 0, 500);
+
+	Range checksum = result.strategy.colwise().sum();
+	AreEq(checksum, 1.0f);
+	REQUIRE((result.strategy >= 0).all());
+
+	for (int card = 0; card < card_count; card++)
+	{
+		REQUIRE(result.achieved_cfvs(card) == Approx(reference.achieved_cfvs(card)).margin(1.0f));
+	}
+}
+
+TEST_CASE("tree_lookahed_batch_matches_single", "[leduc]")
+{
+	Node node;
+	card_to_string_conversion converter;
+	node.board = converter.string_to_board("Ks");
+	node.street = 2;
+	node.current_player = P1;
+	node.bets << 300, 300;
+
+	Ranges player_ranges(3, card_count);
+	Ranges opponent_ranges(3, card_count);
+	player_ranges <<
+		0.2f, 0.2f, 0.0f, 0.2f, 0.2f, 0.2f,
+		0.5f, 0.1f, 0.0f, 0.1f, 0.2f, 0.1f,
+		0.0f, 0.3f, 0.0f, 0.3f, 0.0f, 0.4f;
+	opponent_ranges <<
+		0.1f, 0.3f, 0.0f, 0.2f, 0.2f, 0.2f,
+		0.2f, 0.2f, 0.0f, 0.2f, 0.2f, 0.2f,
+		0.4f, 0.0f, 0.0f, 0.1f, 0.4f, 0.1f;
+
+	Resolving batchResolver;
+	vector<LookaheadResult> results = batchResolver.resolve_first_node_batch(node, player_ranges, opponent_ranges);
+	REQUIRE(results.size() == 3);
+
+	for (int situation = 0; situation < 3; situation++)
+	{
+		Resolving resolver;
+		ArrayX player_range = player_ranges.row(situation);
+		ArrayX opponent_range = opponent_ranges.row(situation);
+		LookaheadResult single = resolver.resolve_first_node(node, player_range, opponent_range);
+
+		REQUIRE(results[situation].strategy.isApprox(single.strategy, myEps));
+		REQUIRE(results[situation].root_cfvs_both_players.isApprox(single.root_cfvs_both_players, myEps));
+
+		//--the fold is masked out at the root, so its cfvs are not defined
+		const int actions = (int)single.children_cfvs.rows() - 1;
+		REQUIRE(results[situation].children_cfvs.bottomRows(actions).isApprox(single.children_cfvs.bottomRows(actions), myEps));
+	}
+}
+
+TEST_CASE("tree_lookahed_grouped_terminal_values", "[leduc]")
+{
+	Node node;
+	card_to_string_conversion converter;
+	node.board = converter.string_to_board("Ks");
+	node.street = 2;
+	node.current_player = P1;
+	node.bets << 300, 300;
+
+	Ranges player_ranges(2, card_count);
+	Ranges opponent_ranges(2, card_count);
+	player_ranges <<
+		0.2f, 0.2f, 0.0f, 0.2f, 0.2f, 0.2f,
+		0.5f, 0.1f, 0.0f, 0.1f, 0.2f, 0.1f;
+	opponent_ranges <<
+		0.1f, 0.3f, 0.0f, 0.2f, 0.2f, 0.2f,
+		0.4f, 0.0f, 0.0f, 0.1f, 0.4f, 0.1f;
+
+	Resolving resolver;
+	resolver._create_lookahead_tree(node);
+	TreeLookahed look(*resolver._lookahead_tree, 0, 10, 2);
+	look.resolve_first_node_batch(player_ranges, opponent_ranges);
+
+	//--a single board, so the fold and the call terminals make two groups
+	REQUIRE(look._terminal_groups.size() == 2);
+
+	//--the grouped evaluation gives the values of the per node one on the ranges of the last iteration
+	look._skipped.assign(look._tree.nodes_count, false);
+	look._fillTerminalValues();
+	ArrayXX grouped_p1 = look._tree.cf_values(P1);
+	ArrayXX grouped_p2 = look._tree.cf_values(P2);
+
+	for (int terminal = 0; terminal < look._tree.nodes_count; terminal++)
+	{
+		if (look._tree.terminal[terminal])
+		{
+			look._fillCFvaluesForTerminalNode(terminal);
+			REQUIRE(look._tree.cf_values(P1).row(terminal).isApprox(grouped_p1.row(terminal), myEps));
+			REQUIRE(look._tree.cf_values(P2).row(terminal).isApprox(grouped_p2.row(terminal), myEps));
+		}
+	}
+}
+
+void RequireSameResults(LookaheadResult& result, LookaheadResult& reference, bool first_node)
+{
+	REQUIRE(result.strategy.isApprox(reference.strategy, myEps));
+	REQUIRE(result.achieved_cfvs.isApprox(reference.achieved_cfvs, myEps));
+
+	if (first_node)
+	{
+		REQUIRE(result.root_cfvs_both_players.isApprox(reference.root_cfvs_both_players, myEps));
+	}
+
+	//--the fold is masked out at the root, so its cfvs are not defined
+	const int actions = (int)reference.children_cfvs.rows() - 1;
+	REQUIRE(result.children_cfvs.bottomRows(actions).isApprox(reference.children_cfvs.bottomRows(actions), myEps));
+}
+
+TEST_CASE("layer_lookahead_matches_tree_lookahed", "[leduc]")
+{
+	card_to_string_conversion converter;
+	card_tools tools;
+
+	for (int player = P1; player <= P2; player++)
+	{
+		Node node;
+		node.board = converter.string_to_board("Ks");
+		node.street = 2;
+		node.current_player = player;
+		node.bets << 800, 800;
+
+		ArrayX player_range = tools.get_uniform_range(node.board);
+		ArrayX opponent_range(card_count);
+		opponent_range << 0.1f, 0.3f, 0.0f, 0.2f, 0.2f, 0.2f;
+		ArrayX op_cfvs(card_count);
+		op_cfvs << -500, 0, 700, -900, 800, 1200;
+
+		Resolving treeResolver(false);
+		Resolving layerResolver(true);
+		LookaheadResult reference = treeResolver.resolve_first_node(node, player_range, opponent_range);
+		LookaheadResult result = layerResolver.resolve_first_node(node, player_range, opponent_range);
+		RequireSameResults(result, reference, true);
+
+		Resolving treeGadgetResolver(false);
+		Resolving layerGadgetResolver(true);
+		reference = treeGadgetResolver.resolve(node, player_range, op_cfvs, 100, 300);
+		result = layerGadgetResolver.resolve(node, player_range, op_cfvs, 100, 300);
+		RequireSameResults(result, reference, false);
+	}
+}
+
+TEST_CASE("tree_lookahed_target_exploitability", "[leduc]")
+{
+	Resolving resolver;
+	Node node;
+	card_to_string_conversion converter;
+	node.board = converter.string_to_board("Ks");
+	node.street = 2;
+	node.current_player = P2;
+	node.bets << 300, 300;
+
+	card_tools tools;
+	Range player_range = tools.get_uniform_range(node.board);
+	Range opponent_range = tools.get_uniform_range(node.board);
+
+	resolver._create_lookahead_tree(node);
+	TreeLookahed look(*resolver._lookahead_tree, 100, 5000);
+	look._target_exploitability = 50;
+	look._target_units = exploitability_mbb;
+	look._exploitability_check_iters = 100;
+	look.resolve_first_node(player_range, opponent_range);
+	LookaheadResult result = look.get_results();
+
+	REQUIRE(look._iterations_done < 5000);
+	REQUIRE(look._exploitability >= 0);
+	REQUIRE(tree_values::to_units(look._exploitability, exploitability_mbb) < 50);
+
+	//--the results are averaged over the iterations that were done
+	Range checksum = result.strategy.colwise().sum();
+	AreEq(checksum, 1.0f);
+	REQUIRE(result.root_cfvs.allFinite());
+}
+
+TEST_CASE("tree_lookahed_zero_reach_skipping", "[leduc]")
+{
+	Node node;
+	card_to_string_conversion converter;
+	node.board = converter.string_to_board("Ks");
+	node.street = 2;
+	node.current_player = P1;
+	node.bets << 300, 300;
+
+	card_tools tools;
+	Range player_range = tools.get_uniform_range(node.board);
+	Range opponent_range = tools.get_uniform_range(node.board);
+
+	Resolving resolver;
+	resolver._create_lookahead_tree(node);
+	TreeLookahed look(*resolver._lookahead_tree, 100, 300);
+	look.resolve_first_node(player_range, opponent_range);
+	LookaheadResult result = look.get_results();
+
+	//--the fold at the root is masked out because there is a free call
+	const int fold = look._tree.first_child[0];
+	REQUIRE(look._skipped[fold]);
+	REQUIRE((look._tree.cf_values(P1).row(fold) == 0).all());
+	REQUIRE((look._tree.cf_values(P2).row(fold) == 0).all());
+
+	//--skipping does not change the result
+	Resolving exactResolver;
+	exactResolver._create_lookahead_tree(node);
+	TreeLookahed exact(*exactResolver._lookahead_tree, 100, 300);
+	exact._prune_reach = -1;
+	exact.resolve_first_node(player_range, opponent_range);
+	LookaheadResult reference = exact.get_results();
+
+	REQUIRE(result.strategy.isApprox(reference.strategy, myEps));
+	REQUIRE(result.root_cfvs_both_players.isApprox(reference.root_cfvs_both_players, myEps));
+}
+
+TEST_CASE("tree_lookahed_regret_pruning", "[leduc]")
+{
+	Node node;
+	card_to_string_conversion converter;
+	node.board = converter.string_to_board("Ks");
+	node.street = 2;
+	node.current_player = P1;
+	node.bets << 100, 100;
+
+	card_tools tools;
+	Range player_range = tools.get_uniform_range(node.board);
+	Range opponent_range = tools.get_uniform_range(node.board);
+
+	Resolving resolver;
+	resolver._create_lookahead_tree(node);
+	TreeLookahed look(*resolver._lookahead_tree, 250, 1000);
+	look._regret_pruning = true;
+	look._pruning_min_iters = 1;
+	look.resolve_first_node(player_range, opponent_range);
+	LookaheadResult result = look.get_results();
+
+	//--the same regret matching without skipping anything
+	Resolving exactResolver;
+	exactResolver._create_lookahead_tree(node);
+	TreeLookahed exact(*exactResolver._lookahead_tree, 250, 1000);
+	exact._regret_pruning = true;
+	exact._pruning_min_iters = numeric_limits<size_t>::max();
+	exact.resolve_first_node(player_range, opponent_range);
+	LookaheadResult reference = exact.get_results();
+
+	REQUIRE(look._pruned_actions > 0);
+	REQUIRE(exact._pruned_actions == 0);
+
+	//--the skipped iterations are brought up to date exactly. The hand blocked by the board
+	//--has no regrets, it plays uniformly over the actions that are not pruned.
+	const ArrayXX possible_hands = tools.get_possible_hand_indexes(node.board).transpose();
+	REQUIRE((result.strategy.rowwise() * possible_hands.row(0)).isApprox(reference.strategy.rowwise() * possible_hands.row(0), myEps));
+	REQUIRE(result.root_cfvs_both_players.isApprox(reference.root_cfvs_both_players, myEps));
+}
+
+TEST_CASE("tree_lookahed_no_malloc", "[leduc]")
+{
+	//--a forbidden allocation fails an Eigen assert, only such builds check anything
+#ifndef EIGEN_RUNTIME_NO_MALLOC
+	WARN("built without EIGEN_RUNTIME_NO_MALLOC, the allocations are not checked");
+#endif
+
+	Node node;
+	card_to_string_conversion converter;
+	node.board = converter.string_to_board("Ks");
+	node.street = 2;
+	node.current_player = P1;
+	node.bets << 100, 100;
+
+	card_tools tools;
+	Range player_range = tools.get_uniform_range(node.board);
+	Range opponent_cfvs(card_count);
+	opponent_cfvs << -500, 0, 700, -900, 800, 1200;
+
+	for (int variant = 0; variant < 3; variant++)
+	{
+		Resolving resolver;
+		resolver._create_lookahead_tree(node);
+		TreeLookahed look(*resolver._lookahead_tree, 50, 200);
+		look._allocation_check = true;
+		look._discounting = variant == 1;
+		look._regret_pruning = variant == 2;
+		look._pruning_min_iters = 1;
+
+		//--the gadget ranges come from the values of the previous iteration
+		if (variant == 0)
+		{
+			look.resolve(player_range, opponent_cfvs);
+		}
+		else
+		{
+			look.resolve_first_node(player_range, player_range);
+		}
+
+		REQUIRE(look._iterations_done == 200);
+	}
+}